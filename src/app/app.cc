@@ -44,6 +44,7 @@ SOFTWARE.
 */
 
 #include "app/app.hh"
+#include "app/dsp.hh"
 #include "app/filter.hh"
 #include "app/util.hh"
 #include "ob/string.hh"
@@ -58,6 +59,7 @@ SOFTWARE.
 #include <array>
 #include <limits>
 #include <memory>
+#include <random>
 #include <string>
 #include <thread>
 #include <vector>
@@ -264,9 +266,114 @@ bool operator!=(Note const& lhs, Note const& rhs) {
   return !(lhs == rhs);
 }
 
-App::App(OB::Parg const& pg) : _pg {pg} {
+App::App(OB::Parg& pg) : _pg {pg} {
   // prevent SFML from writing to std::cerr
   sf::err().rdbuf(nullptr);
+
+  if (_pg.find("overlap")) {
+    _overlap = clamp(_pg.get<double>("overlap"), 0.0, 95.0) / 100.0;
+  }
+
+  if (_pg.find("size")) {
+    auto const size = _pg.get<std::size_t>("size");
+    if (size < 64 || size % 2) {
+      throw std::runtime_error("size must be an even number of samples, no less than 64");
+    }
+    _cfg.size = size;
+    _rec.size(size);
+  }
+
+  if (_pg.find("analysis")) {
+    auto const str = _pg.get<std::string>("analysis");
+    if (str == "cqt") {
+      _rec.analysis(Record::Analysis::cqt);
+    }
+    else if (str == "sdft") {
+      _rec.analysis(Record::Analysis::sdft);
+    }
+    else if (str == "goertzel") {
+      _rec.analysis(Record::Analysis::goertzel);
+    }
+    else if (str != "fft") {
+      throw std::runtime_error("analysis must be either 'fft', 'cqt', 'sdft' or 'goertzel'");
+    }
+  }
+
+  if (_pg.find("multirate")) {
+    auto const factor = _pg.get<std::size_t>("multirate");
+    if (factor != 1 && factor != 2 && factor != 4 && factor != 8) {
+      throw std::runtime_error("multirate must be either 1, 2, 4 or 8");
+    }
+    if (factor > 1 && _rec.analysis() != Record::Analysis::fft) {
+      throw std::runtime_error("multirate requires the fft analysis");
+    }
+    _rec.multirate(factor);
+  }
+
+  if (_pg.find("zoom")) {
+    if (_rec.analysis() != Record::Analysis::fft || _rec.multirate() > 1) {
+      throw std::runtime_error("zoom requires the fft analysis without multirate");
+    }
+    _rec.zoom(true);
+  }
+
+  auto pace = Source::Pace::realtime;
+  if (_pg.find("pace")) {
+    auto const str = _pg.get<std::string>("pace");
+    if (str == "fast") {
+      pace = Source::Pace::fast;
+    }
+    else if (str != "realtime") {
+      throw std::runtime_error("pace must be either 'realtime' or 'fast'");
+    }
+  }
+
+  _bench = _pg.find("bench");
+  _bench_fft = _pg.find("bench-fft");
+
+  if (_pg.find("input") && _pg.find("synth")) {
+    throw std::runtime_error("input and synth cannot be used together");
+  }
+
+  // sample rate and channels of raw and generated input
+  auto const rate = _pg.get<unsigned int>("rate");
+  if (rate < 8000 || rate > 192000) {
+    throw std::runtime_error("rate must be from 8000 to 192000");
+  }
+  auto const channels = _pg.get<unsigned int>("channels");
+  if (channels != 1 && channels != 2) {
+    throw std::runtime_error("channels must be either 1 or 2");
+  }
+
+  if (_pg.find("input")) {
+    auto const path = _pg.get<std::string>("input");
+    if (Stream_Source::is_stream(path)) {
+      // stdin carries samples instead of key presses
+      _read_keys = path != "-";
+      _rec.source(std::make_unique<Stream_Source>(path, Stream_Source::format(_pg.get<std::string>("format")), rate, channels, pace));
+    }
+    else {
+      _rec.source(std::make_unique<File_Source>(path, pace));
+    }
+  }
+  else if (_pg.find("synth")) {
+    auto const signal = Synth_Source::signal(_pg.get<std::string>("synth"));
+    // a benchmark needs an end, default to 10 seconds
+    auto const duration = _pg.find("duration") ? _pg.get<double>("duration") : (_bench ? 10.0 : 0.0);
+    if (duration < 0) {
+      throw std::runtime_error("duration must not be negative");
+    }
+    auto const length = static_cast<std::uint64_t>(duration * rate);
+    // a signal that never ends would keep the benchmark running forever
+    if (_bench && length == 0) {
+      throw std::runtime_error("bench requires a duration of at least one sample");
+    }
+    _rec.source(std::make_unique<Synth_Source>(signal, rate, channels, length, pace));
+  }
+
+  if (_bench && !_rec.source()) {
+    throw std::runtime_error("bench requires an input or synth");
+  }
 }
 
 App::~App() {
@@ -280,7 +387,7 @@ void App::screen_init() {
   << aec::screen_clear
   << aec::cursor_home
   << std::flush;
-  if (!_raw_output) {
+  if (_term_mode) {
     _term_mode->set_raw();
   }
 }
@@ -291,7 +398,7 @@ void App::screen_deinit() {
   << aec::screen_pop
   << aec::cursor_show
   << std::flush;
-  if (!_raw_output) {
+  if (_term_mode) {
     _term_mode->set_cooked();
   }
 }
@@ -445,6 +552,7 @@ bool App::on_read(Read::Key& ctx) {
           _cfg.threshold_max = -24.0;
           _cfg.sort_log = false;
           _cfg.octave_scale = 24;
+          _rec.octave_scale(_cfg.octave_scale);
           _cfg.filter = Filter_Type::sg;
           _cfg.filter_threshold = 0.10;
           _cfg.filter_size = 3;
@@ -502,6 +610,7 @@ bool App::on_read(Read::Key& ctx) {
           _rec.low_pass(_cfg.low_pass);
           _rec.high_pass(_cfg.high_pass);
           _rec.sample_rate(_cfg.sample_rate);
+          _cfg.sample_rate = _rec.sample_rate();
           // _channel = clampc(_channel + 1, static_cast<int>(Channel_Type::mono_mixed), static_cast<int>(Channel_Type::size - 1));
           if (_cfg.mono) {
             _rec.channels(1);
@@ -576,6 +685,7 @@ bool App::on_read(Read::Key& ctx) {
         _rec.low_pass(_cfg.low_pass);
         _rec.high_pass(_cfg.high_pass);
         _rec.sample_rate(_cfg.sample_rate);
+        _cfg.sample_rate = _rec.sample_rate();
         // _channel = clampc(_channel + 1, static_cast<int>(Channel_Type::mono_mixed), static_cast<int>(Channel_Type::size - 1));
         if (_cfg.mono) {
           _rec.channels(1);
@@ -921,59 +1031,104 @@ void App::bar_calc_dimensions(Bars& bars) {
   }
 }
 
-void App::bar_process(std::vector<double> const& bins, Bars& bars) {
-  auto const bin_freq_res = _rec.sample_rate() / static_cast<double>(_cfg.size);
-  auto const low = _rec.high_pass() + std::fmod(_rec.high_pass(), bin_freq_res);
-  _info.resize(bars.size);
+App::Plan const& App::bar_plan(Record::View<double> const freqs, Bars& bars) {
+  // the bin ranges only depend on the bars and the layout of the spectrum, not on the bins themselves,
+  // so they are found once here instead of for every spectrum
+  auto& plan = bars.plan;
+  std::size_t const size {freqs.size()};
+  bool const same {plan.bars == bars.size && plan.bins == size && plan.front == freqs.front() && plan.back == freqs.back() &&
+    plan.sort_log == _cfg.sort_log && plan.octave_scale == _cfg.octave_scale && plan.analysis == _rec.analysis() &&
+    plan.multirate == _rec.multirate() && plan.sample_rate == _rec.sample_rate() && plan.size == _rec.size()};
+  if (same) {return plan;}
+  plan.bars = bars.size;
+  plan.bins = size;
+  plan.front = freqs.front();
+  plan.back = freqs.back();
+  plan.sort_log = _cfg.sort_log;
+  plan.octave_scale = _cfg.octave_scale;
+  plan.analysis = _rec.analysis();
+  plan.multirate = _rec.multirate();
+  plan.sample_rate = _rec.sample_rate();
+  plan.size = _rec.size();
+  plan.begin.clear();
+  plan.end.clear();
+  plan.freq.clear();
+
+  auto const add = [&](std::size_t const p, std::size_t i) {
+    // an empty range at the top of the spectrum reads the bin it starts at
+    if (i <= p) {i = p + 1;}
+    plan.begin.emplace_back(p);
+    plan.end.emplace_back(i);
+    // the geometric centre of the range, kept above 1hz for the note name
+    plan.freq.emplace_back(std::sqrt(std::max(freqs[p], 1.0) * std::max(freqs[i - 1], 1.0)));
+  };
 
-  if (bins.size()) {
-    if (_cfg.sort_log) {
-      std::size_t T {0};
-      for (std::size_t x = 0, p = 0, i = 0; x < bars.size; ++x) {
-        i = static_cast<std::size_t>(std::trunc(scale_log(static_cast<double>(x + 1), 1.0, static_cast<double>(bars.size), 1.0, static_cast<double>(bins.size())) + 0.001));
-        if (p >= i) {i = p + 1;}
-        if (i >= bins.size()) {i = bins.size() - 1;}
-        auto const begin = bins.begin() + p;
-        auto const end = bins.begin() + i;
-
-        // value is based on average of elements in the range
-        // double v = std::accumulate(begin, end, 0.0) / (i - p);
-        // bars.raw[x] = v;
-
-        // value is based on max element in the range
-        auto const ptr = std::max_element(begin, end);
-
-        bars.raw[x] = *ptr;
-
-        _info[x] = Info{bin_freq_res * static_cast<double>(std::distance(bins.begin(), ptr)) + static_cast<std::size_t>(std::trunc(low))};
-        T += i - p;
-        p = i;
+  if (_cfg.sort_log) {
+    // centre frequency of each bin, linearly spaced for the fft analysis, geometrically spaced for the others
+    bool const geometric {_rec.analysis() != Record::Analysis::fft};
+    // the bass band of the multirate analysis has finer bins than the rest of the spectrum
+    bool const multirate {_rec.multirate() > 1};
+    auto const bin_freq_res = _rec.sample_rate() / static_cast<double>(_rec.size());
+    for (std::size_t x = 0, p = 0, i = 0; x < bars.size; ++x) {
+      // geometrically spaced bins are already on a log scale
+      if (geometric) {
+        i = (x + 1) * size / bars.size;
+      }
+      else if (multirate) {
+        // bars end at the frequency they would end at with the bins of the short window alone
+        auto const span = (freqs.back() - freqs.front()) / bin_freq_res + 1.0;
+        auto const hz = freqs.front() + bin_freq_res * scale_log(static_cast<double>(x + 1), 1.0, static_cast<double>(bars.size), 1.0, span);
+        i = static_cast<std::size_t>(std::distance(freqs.begin(), std::lower_bound(freqs.begin(), freqs.end(), hz)));
+      }
+      else {
+        i = static_cast<std::size_t>(std::trunc(scale_log(static_cast<double>(x + 1), 1.0, static_cast<double>(bars.size), 1.0, static_cast<double>(size)) + 0.001));
       }
+      if (p >= i) {i = p + 1;}
+      if (i >= size) {i = size - 1;}
+      add(p, i);
+      p = i;
     }
-    else {
-      std::size_t T {0};
-      std::vector<std::pair<double, double>> raw;
-      for (std::size_t x = 0, p = 0, i = 0; p + 1 < bins.size(); ++x) {
-        Note const note {bin_freq_res * p + low, _cfg.octave_scale};
-        for (++i; i < bins.size(); ++i) {
-          if (note != Note(bin_freq_res * i + low, _cfg.octave_scale)) {
-            break;
-          }
+  }
+  else {
+    // one range for each note
+    for (std::size_t p = 0, i = 0; p + 1 < size;) {
+      Note const note {freqs[p], _cfg.octave_scale};
+      for (++i; i < size; ++i) {
+        if (note != Note(freqs[i], _cfg.octave_scale)) {
+          break;
         }
-        if (p >= i) {i = p + 1;}
-        if (i >= bins.size()) {i = bins.size() - 1;}
-        auto const begin = bins.begin() + p;
-        auto const end = bins.begin() + i;
+      }
+      if (p >= i) {i = p + 1;}
+      if (i >= size) {i = size - 1;}
+      add(p, i);
+      p = i;
+    }
+  }
+  return plan;
+}
 
-        // value is based on average of elements in the range
-        // double v = std::accumulate(begin, end, 0.0) / (i - p);
-        // value is based on max element in the range
-        auto const ptr = std::max_element(begin, end);
+void App::bar_process(Record::View<Record::value_type> const bins, Bars& bars) {
+  auto const freqs = _rec.frequencies();
+  _info.resize(bars.size);
 
-        raw.emplace_back(*ptr, bin_freq_res * static_cast<double>(std::distance(bins.begin(), ptr)) + static_cast<std::size_t>(std::trunc(low)));
+  if (bins.size() && freqs.size() == bins.size()) {
+    auto const& plan = bar_plan(freqs, bars);
+    // value is based on max element in the range
+    // the ranges follow each other without overlapping, so this reads each bin about once
+    auto const range_max = [&](std::size_t const x) {
+      return *std::max_element(bins.begin() + plan.begin[x], bins.begin() + plan.end[x]);
+    };
 
-        T += i - p;
-        p = i;
+    if (_cfg.sort_log) {
+      for (std::size_t x = 0; x < bars.size; ++x) {
+        bars.raw[x] = range_max(x);
+        _info[x] = Info{plan.freq[x]};
+      }
+    }
+    else {
+      std::vector<std::pair<double, double>> raw (plan.begin.size());
+      for (std::size_t x = 0; x < raw.size(); ++x) {
+        raw[x] = {range_max(x), plan.freq[x]};
       }
 
       // TODO make each octave as equally represented as possible
@@ -981,6 +1136,7 @@ void App::bar_process(std::vector<double> const& bins, Bars& bars) {
       // split bars by octave
       // resample each octave to either 12 or 24 notes
       // resample all bars to final size
+      // the constant-q analysis gives every octave the same number of notes
       auto const db_hz = Filter::resample(raw, bars.size, raw.size());
       for (std::size_t i = 0; i < bars.size; ++i) {
         auto const& e = db_hz[i];
@@ -1024,7 +1180,7 @@ void App::bar_movement(double const dt, Bars& bars) {
         bars.freq[i] = lerp(bars.freq[i], bars.raw[i], 1.0 - std::pow(1.0 - _cfg.speed_freq_up, dt));
       }
       else {
-        bars.freq[i] += std::min((std::abs(_cfg.threshold_max - _cfg.threshold_min) * _cfg.speed_freq_up) * dt, std::abs(bars.raw[i] - bars.freq[i]));
+        bars.freq[i] += std::min<double>((std::abs(_cfg.threshold_max - _cfg.threshold_min) * _cfg.speed_freq_up) * dt, std::abs(bars.raw[i] - bars.freq[i]));
       }
     }
     else if (bars.freq[i] > bars.raw[i]) {
@@ -1032,7 +1188,7 @@ void App::bar_movement(double const dt, Bars& bars) {
         bars.freq[i] = lerp(bars.freq[i], bars.raw[i], 1.0 - std::pow(1.0 - _cfg.speed_freq_down, dt));
       }
       else {
-        bars.freq[i] -= std::min((std::abs(_cfg.threshold_max - _cfg.threshold_min) * _cfg.speed_freq_down) * dt, std::abs(bars.freq[i] - bars.raw[i]));
+        bars.freq[i] -= std::min<double>((std::abs(_cfg.threshold_max - _cfg.threshold_min) * _cfg.speed_freq_down) * dt, std::abs(bars.freq[i] - bars.raw[i]));
       }
     }
 
@@ -1046,7 +1202,7 @@ void App::bar_movement(double const dt, Bars& bars) {
     if (bars.peak[i] > bars.freq[i]) {
       if (_cfg.speed_peak_unique) {
         if (_cfg.peak_reverse) {
-          bars.peak[i] = lerp(bars.peak[i], _cfg.threshold_max, 1.0 - std::pow(1.0 - _cfg.speed_peak_down, dt));
+          bars.peak[i] = lerp<double>(bars.peak[i], _cfg.threshold_max, 1.0 - std::pow(1.0 - _cfg.speed_peak_down, dt));
         }
         else {
           bars.peak[i] = lerp(bars.peak[i], bars.freq[i], 1.0 - std::pow(1.0 - _cfg.speed_peak_down, dt));
@@ -1057,7 +1213,7 @@ void App::bar_movement(double const dt, Bars& bars) {
           bars.peak[i] += std::abs(_cfg.threshold_max - _cfg.threshold_min) * _cfg.speed_peak_down * dt;
         }
         else {
-          bars.peak[i] -= std::min((std::abs(_cfg.threshold_max - _cfg.threshold_min) * _cfg.speed_peak_down) * dt, std::abs(bars.peak[i] - bars.freq[i]));
+          bars.peak[i] -= std::min<double>((std::abs(_cfg.threshold_max - _cfg.threshold_min) * _cfg.speed_peak_down) * dt, std::abs(bars.peak[i] - bars.freq[i]));
         }
       }
     }
@@ -1229,6 +1385,9 @@ void App::draw_overlay() {
         + " | sort "s + (_cfg.sort_log ? "log"s : "note"s)
         + " | fps "s + std::to_string(_cfg.fps)
       };
+      if (auto const* source = _rec.source()) {
+        title += " | xrun "s + std::to_string(source->underruns()) + ":"s + std::to_string(source->overruns());
+      }
       if (title.size() > _width) {
         _overlay_index = std::min(_overlay_index, (title.size() - _width));
         title = title.substr(_overlay_index, _width);
@@ -1589,14 +1748,12 @@ void App::render() {
 }
 
 void App::run() {
-  await_signal();
-
-  if (!_raw_output) {
-    auto const is_term = Term::is_term(STDOUT_FILENO);
-    if (!is_term) {throw std::runtime_error("stdout is not a tty");}
+  if (_bench_fft) {
+    bench_fft();
+    return;
   }
 
-  if (! _rec.available()) {
+  if (!_rec.source() && !_rec.available()) {
     throw std::runtime_error("recording device is unavailable");
   }
 
@@ -1606,8 +1763,14 @@ void App::run() {
   else {
     _rec.channels(2);
   }
+  // a source decides the sample rate
+  if (_rec.source()) {
+    _cfg.sample_rate = _rec.sample_rate();
+    _cfg.low_pass = std::min(_cfg.low_pass, _cfg.sample_rate / 2);
+  }
   _rec.low_pass(_cfg.low_pass);
   _rec.high_pass(_cfg.high_pass);
+  _rec.octave_scale(_cfg.octave_scale);
   _rec.sample_rate(_cfg.sample_rate);
   _rec.device(_rec.device_default());
   // for (auto const& device : _rec.devices()) {
@@ -1617,6 +1780,19 @@ void App::run() {
   //   }
   // }
   _rec.process_interval(sf::milliseconds(_cfg.interval));
+  _rec.hop(static_cast<std::size_t>(std::round(_cfg.size * (1.0 - _overlap))));
+
+  if (_bench) {
+    bench();
+    return;
+  }
+
+  await_signal();
+
+  if (!_raw_output) {
+    auto const is_term = Term::is_term(STDOUT_FILENO);
+    if (!is_term) {throw std::runtime_error("stdout is not a tty");}
+  }
 
   auto const buf_size = _cfg.size / 2;
   _bars_left.raw.assign(buf_size, _cfg.threshold_min);
@@ -1634,12 +1810,12 @@ void App::run() {
   }
   _win.style_base = _style_base;
 
-  if (!_raw_output) {
+  if (!_raw_output && _read_keys) {
     _term_mode = std::make_unique<OB::Term::Mode>();
   }
   screen_init();
   on_winch();
-  if (!_raw_output) {
+  if (!_raw_output && _read_keys) {
     await_read();
   }
   _tick_begin = Clock::now();
@@ -1649,3 +1825,498 @@ void App::run() {
   _rec.stop();
   screen_deinit();
 }
+
+void App::bench() {
+  auto const* source = _rec.source();
+
+  auto const begin = Clock::now();
+  _rec.start();
+  // the analysis thread keeps up on its own,
+  // wait for the end of the input and for the last hop of it to be analysed
+  while (!source->done() || _rec.pending() >= _rec.hop()) {
+    std::this_thread::sleep_for(1ms);
+  }
+  auto const elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+  _rec.stop();
+
+  auto const input = static_cast<double>(source->frames()) / source->sample_rate();
+  auto const frames = _rec.frames();
+
+  std::cout
+  << std::fixed << std::setprecision(3)
+  << "input    " << input << " s, " << source->frames() << " frames, " << source->sample_rate() << " Hz, " << source->channels() << " channels\n"
+  << "analysis " << frames << " frames, " << _rec.frames_skipped() << " skipped, size " << _rec.size() << ", hop " << _rec.hop() << "\n"
+  << "xruns    " << source->underruns() << " underruns, " << source->overruns() << " overruns\n"
+  << "elapsed  " << elapsed << " s\n"
+  << "speed    " << (frames / elapsed) << " frames/s, " << (input / elapsed) << "x realtime\n"
+  << std::flush;
+}
+
+// the fft kernel chosen for each power of two from 512 to 65536 against the stockham and mixed radix kernels,
+// the kernel chosen for other sizes against the mixed radix kernel,
+// the four-step kernel from 131072 to 524288 on each number of threads against the stockham kernel,
+// the stereo transform in its own buffers and in place against a real transform of each channel,
+// the real transforms against the complex transform, the decibel kernel against std::log10,
+// and the float analysis against the double analysis
+void App::bench_fft() {
+  using value_type = Record::value_type;
+  using complex_type = std::complex<value_type>;
+  auto const kernel_name = [](OB::FFT_Kernel const kernel) {
+    switch (kernel) {
+      case OB::FFT_Kernel::stockham: return "stockham";
+      case OB::FFT_Kernel::fixed: return "fixed";
+      case OB::FFT_Kernel::bluestein: return "bluestein";
+      case OB::FFT_Kernel::four_step: return "four-step";
+      default: return "mixed radix";
+    }
+  };
+
+  // microseconds per call, repeated for at least 50ms and 3 calls
+  auto const time = [](auto const& fn) {
+    std::size_t iterations {0};
+    auto const begin = Clock::now();
+    auto end = begin;
+    do {
+      fn();
+      ++iterations;
+      end = Clock::now();
+    }
+    while (iterations < 3 || end - begin < 50ms);
+    return std::chrono::duration<double, std::micro>(end - begin).count() / iterations;
+  };
+
+  // largest difference between two outputs, relative to the largest bin of the reference
+  auto const error = [](complex_type const* out, complex_type const* ref, std::size_t const size) {
+    double diff {0};
+    double peak {0};
+    for (std::size_t i = 0; i < size; ++i) {
+      diff = std::max(diff, static_cast<double>(std::abs(out[i] - ref[i])));
+      peak = std::max(peak, static_cast<double>(std::abs(ref[i])));
+    }
+    return diff / peak;
+  };
+
+  // each error is checked against a bound, the benchmark fails if any is over it
+  std::size_t failed {0};
+  auto const check = [&failed](double const err, double const bound) {
+    if (err > bound) {
+      ++failed;
+      return "  over bound";
+    }
+    return "";
+  };
+
+  // relative bound of the fft comparisons, rounding grows with log2 of the size
+  double const fft_bound {100.0 * std::numeric_limits<value_type>::epsilon()};
+
+  std::mt19937 gen {1};
+  std::uniform_real_distribution<value_type> dist {-1, 1};
+
+  std::cout
+  << std::left
+  << std::setw(8) << "size"
+  << std::setw(14) << "kernel"
+  << std::setw(12) << "time us"
+  << std::setw(10) << "mflops"
+  << std::setw(14) << "stockham us"
+  << std::setw(16) << "mixed radix us"
+  << std::setw(10) << "speedup"
+  << "error\n";
+
+  for (std::size_t size = 512; size <= 65536; size *= 2) {
+    std::vector<complex_type> in (size);
+    for (auto& e : in) {
+      e = complex_type(dist(gen), dist(gen));
+    }
+    std::vector<complex_type> out;
+    std::vector<complex_type> ref;
+
+    Record::FFT fft;
+    Record::FFT stockham;
+    stockham.kernel(OB::FFT_Kernel::stockham);
+    Record::FFT mixed;
+    mixed.kernel(OB::FFT_Kernel::mixed_radix);
+    fft(in, out);
+    mixed(in, ref);
+    auto const err = error(&out[0], &ref[0], size);
+
+    auto const us = time([&] {fft(in, out);});
+    auto const us_stockham = time([&] {stockham(in, out);});
+    auto const us_mixed = time([&] {mixed(in, out);});
+
+    std::cout
+    << std::setw(8) << size
+    << std::setw(14) << kernel_name(fft.kernel())
+    << std::fixed << std::setprecision(2)
+    << std::setw(12) << us
+    << std::setprecision(0)
+    << std::setw(10) << (5.0 * size * std::log2(size) / us)
+    << std::setprecision(2)
+    << std::setw(14) << us_stockham
+    << std::setw(16) << us_mixed
+    << std::setw(10) << (us_mixed / us)
+    << std::scientific << std::setprecision(2)
+    << err << check(err, fft_bound) << "\n"
+    << std::defaultfloat;
+  }
+
+  // sizes that are not a power of two, against the mixed radix kernel
+  std::cout
+  << "\n"
+  << std::setw(8) << "size"
+  << std::setw(14) << "kernel"
+  << std::setw(12) << "time us"
+  << std::setw(16) << "mixed radix us"
+  << std::setw(10) << "speedup"
+  << "error\n";
+
+  for (std::size_t const size : {1000u, 1021u, 2002u, 4093u, 30030u, 44100u, 48000u}) {
+    std::vector<complex_type> in (size);
+    for (auto& e : in) {
+      e = complex_type(dist(gen), dist(gen));
+    }
+    std::vector<complex_type> out;
+    std::vector<complex_type> ref;
+
+    Record::FFT fft;
+    Record::FFT mixed;
+    mixed.kernel(OB::FFT_Kernel::mixed_radix);
+    fft(in, out);
+    mixed(in, ref);
+    auto const err = error(&out[0], &ref[0], size);
+
+    auto const us = time([&] {fft(in, out);});
+    auto const us_mixed = time([&] {mixed(in, out);});
+
+    std::cout
+    << std::setw(8) << size
+    << std::setw(14) << kernel_name(fft.kernel())
+    << std::fixed << std::setprecision(2)
+    << std::setw(12) << us
+    << std::setw(16) << us_mixed
+    << std::setw(10) << (us_mixed / us)
+    << std::scientific << std::setprecision(2)
+    << err << check(err, fft_bound) << "\n"
+    << std::defaultfloat;
+  }
+
+  // the four-step kernel on each number of threads up to the hardware threads, against the stockham kernel
+  std::cout
+  << "\n"
+  << std::setw(8) << "size"
+  << std::setw(10) << "threads"
+  << std::setw(12) << "time us"
+  << std::setw(14) << "stockham us"
+  << std::setw(10) << "speedup"
+  << "error\n";
+
+  std::size_t const hardware_threads {std::max<std::size_t>(1, std::thread::hardware_concurrency())};
+  for (std::size_t size = 131072; size <= 524288; size *= 2) {
+    std::vector<complex_type> in (size);
+    for (auto& e : in) {
+      e = complex_type(dist(gen), dist(gen));
+    }
+    std::vector<complex_type> out;
+    std::vector<complex_type> ref;
+
+    Record::FFT stockham;
+    stockham.kernel(OB::FFT_Kernel::stockham);
+    stockham(in, ref);
+    auto const us_stockham = time([&] {stockham(in, out);});
+
+    for (std::size_t threads = 1;; threads = std::min(2 * threads, hardware_threads)) {
+      Record::FFT fft;
+      fft.kernel(OB::FFT_Kernel::four_step);
+      fft.threads(threads);
+      fft(in, out);
+      auto const err = error(&out[0], &ref[0], size);
+      auto const us = time([&] {fft(in, out);});
+
+      std::cout
+      << std::setw(8) << size
+      << std::setw(10) << fft.threads()
+      << std::fixed << std::setprecision(2)
+      << std::setw(12) << us
+      << std::setw(14) << us_stockham
+      << std::setw(10) << (us_stockham / us)
+      << std::scientific << std::setprecision(2)
+      << err << check(err, fft_bound) << "\n"
+      << std::defaultfloat;
+
+      if (threads == hardware_threads) {
+        break;
+      }
+    }
+  }
+
+  // both stereo channels in one complex fft against a real fft for each channel
+  std::cout
+  << "\n"
+  << std::setw(8) << "size"
+  << std::setw(12) << "pair us"
+  << std::setw(14) << "in-place us"
+  << std::setw(14) << "two real us"
+  << std::setw(10) << "speedup"
+  << "error\n";
+
+  for (std::size_t size = 512; size <= 65536; size *= 2) {
+    std::vector<value_type> left (size);
+    std::vector<value_type> right (size);
+    for (std::size_t i = 0; i < size; ++i) {
+      left[i] = dist(gen);
+      right[i] = dist(gen);
+    }
+    std::vector<complex_type> out_left (size / 2);
+    std::vector<complex_type> out_right (size / 2);
+    std::vector<complex_type> ref_left;
+    std::vector<complex_type> ref_right;
+
+    Record::FFT pair;
+    Record::FFT real;
+    pair.pair(&left[0], &right[0], &out_left[0], &out_right[0], size);
+    real(left, ref_left);
+    real(right, ref_right);
+    auto err = std::max(error(&out_left[0], &ref_left[0], size / 2), error(&out_right[0], &ref_right[0], size / 2));
+
+    auto const us_pair = time([&] {pair.pair(&left[0], &right[0], &out_left[0], &out_right[0], size);});
+    auto const us_real = time([&] {real(left, ref_left); real(right, ref_right);});
+
+    // the transform used by the analysis, the inputs are copied in as the window is applied
+    OB::aligned_vector<value_type> work (Record::FFT::workspace(size));
+    auto const us_split = time([&] {
+      std::copy(left.begin(), left.end(), &work[0]);
+      std::copy(right.begin(), right.end(), &work[size]);
+      pair.pair_split(&work[0], size);
+    });
+
+    // the in-place bins are laid out as the split real and imaginary parts of each channel
+    std::copy(left.begin(), left.end(), &work[0]);
+    std::copy(right.begin(), right.end(), &work[size]);
+    value_type const* const split {pair.pair_split(&work[0], size)};
+    for (std::size_t k = 0; k < size / 2; ++k) {
+      out_left[k] = complex_type(split[k], split[size / 2 + k]);
+      out_right[k] = complex_type(split[size + k], split[3 * size / 2 + k]);
+    }
+    err = std::max({err, error(&out_left[0], &ref_left[0], size / 2), error(&out_right[0], &ref_right[0], size / 2)});
+
+    std::cout
+    << std::setw(8) << size
+    << std::fixed << std::setprecision(2)
+    << std::setw(12) << us_pair
+    << std::setw(14) << us_split
+    << std::setw(14) << us_real
+    << std::setw(10) << (us_real / us_pair)
+    << std::scientific << std::setprecision(2)
+    << err << check(err, fft_bound) << "\n"
+    << std::defaultfloat;
+  }
+
+  // the real transforms against the complex transform of the same input with no imaginary part,
+  // compared by the magnitude of each bin, bin 0 and the nyquist bin from their packed parts
+  std::cout
+  << "\n"
+  << std::setw(8) << "size"
+  << std::setw(12) << "real us"
+  << std::setw(12) << "split us"
+  << std::setw(14) << "complex us"
+  << std::setw(10) << "speedup"
+  << "error\n";
+
+  std::vector<std::size_t> real_sizes;
+  for (std::size_t size = 512; size <= 65536; size *= 2) {
+    real_sizes.emplace_back(size);
+  }
+  real_sizes.insert(real_sizes.end(), {1000u, 2002u, 30030u, 44100u, 48000u});
+
+  for (std::size_t const size : real_sizes) {
+    std::size_t const half {size / 2};
+    std::vector<value_type> in (size);
+    std::vector<complex_type> cin (size);
+    for (std::size_t i = 0; i < size; ++i) {
+      in[i] = dist(gen);
+      cin[i] = complex_type(in[i], 0);
+    }
+    std::vector<complex_type> out;
+    std::vector<complex_type> ref;
+
+    Record::FFT real;
+    Record::FFT split;
+    Record::FFT full;
+    full(cin, ref);
+    real(in, out);
+
+    // the workspace holds the even samples then the odd samples
+    OB::aligned_vector<value_type> work (Record::FFT::workspace(size));
+    auto const deinterleave = [&] {
+      for (std::size_t i = 0; i < half; ++i) {
+        work[i] = in[2 * i];
+        work[half + i] = in[2 * i + 1];
+      }
+    };
+    deinterleave();
+    value_type const* const zr {split.real_split(&work[0], size)};
+    value_type const* const zi {zr + half};
+
+    double diff {0};
+    double peak {0};
+    for (std::size_t k = 0; k <= half; ++k) {
+      double const mag {std::abs(ref[k])};
+      double const mag_real {k == 0 ? std::abs(out[0].real()) : k == half ? std::abs(out[0].imag()) : std::abs(out[k])};
+      double const mag_split {k == 0 ? std::abs(zr[0]) : k == half ? std::abs(zi[0]) : std::abs(complex_type(zr[k], zi[k]))};
+      diff = std::max({diff, std::abs(mag_real - mag), std::abs(mag_split - mag)});
+      peak = std::max(peak, mag);
+    }
+    auto const err = diff / peak;
+
+    auto const us_real = time([&] {real(in, out);});
+    auto const us_split = time([&] {deinterleave(); split.real_split(&work[0], size);});
+    auto const us_full = time([&] {full(cin, ref);});
+
+    std::cout
+    << std::setw(8) << size
+    << std::fixed << std::setprecision(2)
+    << std::setw(12) << us_real
+    << std::setw(12) << us_split
+    << std::setw(14) << us_full
+    << std::setw(10) << (us_full / us_real)
+    << std::scientific << std::setprecision(2)
+    << err << check(err, fft_bound) << "\n"
+    << std::defaultfloat;
+  }
+
+  // the decibel kernel against std::log10 of the magnitude, over magnitudes from 1e-6 to 10
+  std::cout
+  << "\n"
+  << std::setw(8) << "size"
+  << std::setw(12) << "kernel us"
+  << std::setw(12) << "log10 us"
+  << std::setw(10) << "speedup"
+  << "error db\n";
+
+  // absolute bound in decibels, both sides round the magnitude in value_type
+  double const db_bound {1000.0 * std::numeric_limits<value_type>::epsilon()};
+  std::uniform_real_distribution<double> exponent {-6, 1};
+  std::uniform_real_distribution<double> phase {0, 2.0 * M_PI};
+  for (std::size_t size = 512; size <= 65536; size *= 2) {
+    std::vector<value_type> re (size);
+    std::vector<value_type> im (size);
+    for (std::size_t i = 0; i < size; ++i) {
+      double const mag {std::pow(10.0, exponent(gen))};
+      double const arg {phase(gen)};
+      re[i] = static_cast<value_type>(mag * std::cos(arg));
+      im[i] = static_cast<value_type>(mag * std::sin(arg));
+    }
+    std::vector<value_type> out (size);
+    std::vector<value_type> ref (size);
+
+    auto const kernel = [&] {DSP::power_db(&re[0], &im[0], &out[0], size, value_type(0), false);};
+    auto const reference = [&] {
+      for (std::size_t i = 0; i < size; ++i) {
+        ref[i] = value_type(20) * std::log10(std::sqrt(re[i] * re[i] + im[i] * im[i]));
+      }
+    };
+    kernel();
+    reference();
+    double err {0};
+    for (std::size_t i = 0; i < size; ++i) {
+      err = std::max(err, std::abs(static_cast<double>(out[i]) - static_cast<double>(ref[i])));
+    }
+
+    auto const us = time(kernel);
+    auto const us_ref = time(reference);
+
+    std::cout
+    << std::setw(8) << size
+    << std::fixed << std::setprecision(2)
+    << std::setw(12) << us
+    << std::setw(12) << us_ref
+    << std::setw(10) << (us_ref / us)
+    << std::scientific << std::setprecision(2)
+    << err << check(err, db_bound) << "\n"
+    << std::defaultfloat;
+  }
+
+  // the analysis in float against the same analysis in double, scaling 16-bit samples,
+  // windowing, the real transform and the decibels, over the bins above the lowest display threshold
+  std::cout
+  << "\n"
+  << std::setw(8) << "size"
+  << std::setw(12) << "float us"
+  << std::setw(12) << "double us"
+  << std::setw(10) << "speedup"
+  << std::setw(8) << "bins"
+  << "error db\n";
+
+  auto const analyse = [](auto const zero, std::int16_t const* const pcm, std::size_t const size) {
+    using T = std::remove_const_t<decltype(zero)>;
+    std::size_t const half {size / 2};
+    auto const hann = DSP::window_table<T>(DSP::Window_Type::hann, size);
+    OB::FFT<T> fft;
+    OB::aligned_vector<T> frame (size);
+    OB::aligned_vector<T> work (OB::FFT<T>::workspace(size));
+    std::vector<T> db (half + 1);
+    T const gain {static_cast<T>(-20.0 * std::log10(static_cast<double>(size)))};
+    return [=]() mutable -> std::vector<T> const& {
+      DSP::convert(pcm, &frame[0], size);
+      DSP::window_deinterleave(&frame[0], hann->data(), &work[0], &work[half], 0, size);
+      T* const re {fft.real_split(&work[0], size)};
+      T* const im {re + half};
+      // the nyquist bin is packed into the imaginary part of bin 0
+      T const nyquist {im[0]};
+      im[0] = 0;
+      DSP::power_db(re, im, &db[0], half, gain, false);
+      DSP::power_db(&nyquist, &zero, &db[half], 1, gain, false);
+      return db;
+    };
+  };
+
+  // a chord of tones from 0 to -90dBFS rounded to 16-bit samples, the rounding noise sits below the display
+  double const db_floor {-120.0};
+  // float rounds the quietest bins most, the bound stays far below the 2dB steps of the display thresholds
+  double const db_float_bound {0.05};
+  for (std::size_t const size : real_sizes) {
+    std::vector<std::int16_t> pcm (size);
+    for (std::size_t i = 0; i < size; ++i) {
+      double v {0};
+      for (std::size_t j = 0; j < 4; ++j) {
+        double const freq {(0.013 + 0.071 * j) * 2.0 * M_PI};
+        v += 0.45 * std::pow(10.0, -1.5 * j) * std::sin(freq * i);
+      }
+      pcm[i] = static_cast<std::int16_t>(std::lround(32767.0 * v));
+    }
+
+    auto analyse_float = analyse(0.0f, &pcm[0], size);
+    auto analyse_double = analyse(0.0, &pcm[0], size);
+    auto const& db_f = analyse_float();
+    auto const& db_d = analyse_double();
+
+    std::size_t bins {0};
+    double err {0};
+    for (std::size_t k = 0; k < db_d.size(); ++k) {
+      if (db_d[k] < db_floor) {
+        continue;
+      }
+      ++bins;
+      err = std::max(err, std::abs(static_cast<double>(db_f[k]) - db_d[k]));
+    }
+
+    auto const us_float = time([&] {analyse_float();});
+    auto const us_double = time([&] {analyse_double();});
+
+    std::cout
+    << std::setw(8) << size
+    << std::fixed << std::setprecision(2)
+    << std::setw(12) << us_float
+    << std::setw(12) << us_double
+    << std::setw(10) << (us_double / us_float)
+    << std::setw(8) << bins
+    << std::scientific << std::setprecision(2)
+    << err << check(err, db_float_bound) << "\n"
+    << std::defaultfloat;
+  }
+  std::cout << std::flush;
+
+  if (failed) {
+    throw std::runtime_error(std::to_string(failed) + " fft bench comparisons are over their error bound");
+  }
+}
@@ -46,9 +46,11 @@ SOFTWARE.
 #ifndef APP_HH
 #define APP_HH
 
+#include "app/dsp.hh"
 #include "app/util.hh"
 #include "app/window.hh"
 #include "app/record.hh"
+#include "app/source.hh"
 
 #include "ob/parg.hh"
 #include "ob/text.hh"
@@ -106,12 +108,32 @@ namespace asio = boost::asio;
 
 class App {
 public:
-  App(OB::Parg const& pg);
+  App(OB::Parg& pg);
   ~App();
 
   void run();
 
 private:
+  // ranges of bins feeding each bar, rebuilt by bar_plan only when the bars or the layout of the spectrum change
+  struct Plan {
+    // what the plan was built for, a layout of the spectrum is told apart by its bins and their first and last frequency
+    std::size_t bars {0};
+    std::size_t bins {0};
+    double front {0};
+    double back {0};
+    bool sort_log {true};
+    std::size_t octave_scale {0};
+    Record::Analysis analysis {Record::Analysis::fft};
+    std::size_t multirate {0};
+    unsigned int sample_rate {0};
+    std::size_t size {0};
+    // first and one past the last bin of each range
+    std::vector<std::size_t> begin;
+    std::vector<std::size_t> end;
+    // frequency shown for each range
+    std::vector<double> freq;
+  };
+
   struct Bars {
     // number of bars to output
     std::size_t size {0};
@@ -134,14 +156,16 @@ private:
     // height of each bar
     std::size_t bar_height {0};
     // raw target values
-    std::vector<double> raw;
+    std::vector<Record::value_type> raw;
     // frequency values
-    std::vector<double> freq;
+    std::vector<Record::value_type> freq;
     // peak values
-    std::vector<double> peak;
+    std::vector<Record::value_type> peak;
+    // bins feeding each bar
+    Plan plan;
   };
 
-  OB::Parg const& _pg;
+  OB::Parg& _pg;
 
   void screen_init();
   void screen_deinit();
@@ -160,7 +184,8 @@ private:
   std::size_t bar_calc_height(double const val, std::size_t height) const;
 
   void bar_calc_dimensions(Bars& bars);
-  void bar_process(std::vector<double> const& bins, Bars& bars);
+  Plan const& bar_plan(Record::View<double> const freqs, Bars& bars);
+  void bar_process(Record::View<Record::value_type> const bins, Bars& bars);
   void bar_movement(double const dt, Bars& bars);
 
   void update(double const dt);
@@ -172,6 +197,8 @@ private:
   void draw_visualizer_impl(std::size_t x_begin, std::size_t y_begin, std::size_t width, std::size_t height, Bars& bars, bool const draw_reverse = false);
 
   void render();
+  void bench();
+  void bench_fft();
 
   // TODO
   // struct Channel_Type {
@@ -273,6 +300,18 @@ private:
   std::string _raw_filename;
   std::ofstream _raw_file;
 
+  // fraction of each analysis window shared with the next one
+  double _overlap {0.75};
+
+  // run the analysis without a terminal and report its throughput
+  bool _bench {false};
+
+  // compare the fft kernels for accuracy and speed, then exit
+  bool _bench_fft {false};
+
+  // read key presses from stdin, off when stdin carries samples
+  bool _read_keys {true};
+
   bool _fixed_size {false};
   std::size_t _width {80};
   std::size_t _height {1};
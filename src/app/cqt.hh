@@ -0,0 +1,182 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef APP_CQT_HH
+#define APP_CQT_HH
+
+#include "ob/fft.hh"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+#include <complex>
+#include <algorithm>
+
+// constant-q transform computed from the spectrum of a single fft frame
+// each bin is the inner product of the frame spectrum with a sparse spectral kernel,
+// the spectrum of a windowed complex sinusoid holding the same number of periods at every frequency,
+// so the bins are spaced and sized by musical interval instead of by hz
+namespace CQT
+{
+
+template<typename T>
+class Kernel {
+public:
+  using value_type = T;
+
+  // kernel values below this fraction of the peak of their kernel are dropped
+  static constexpr double threshold {0.005};
+
+  // geometrically spaced bins from `low` up to `high` hz, `octave` bins per octave,
+  // for unwindowed frames of `size` samples at `sample_rate`
+  // a bin whose window would be longer than a frame is cut to the frame, widening its bandwidth
+  void init(double const sample_rate, std::size_t const size, double const low, double const high, std::size_t const octave) {
+    _sample_rate = sample_rate;
+    _size = size;
+    _low = low;
+    _high = high;
+    _octave = octave;
+
+    _frequency.clear();
+    _begin.assign(1, 0);
+    _index.clear();
+    _re.clear();
+    _im.clear();
+    if (size < 4 || octave == 0 || low <= 0 || high < low) {return;}
+
+    double const q {1.0 / (std::pow(2.0, 1.0 / static_cast<double>(octave)) - 1.0)};
+    double const nyquist {sample_rate / 2.0};
+    std::size_t const half {size / 2};
+
+    OB::FFT<double> fft;
+    std::vector<std::complex<double>> temporal (size);
+    std::vector<std::complex<double>> spectral;
+    for (std::size_t k = 0;; ++k) {
+      double const freq {low * std::pow(2.0, static_cast<double>(k) / static_cast<double>(octave))};
+      if (freq > high || freq >= nyquist) {break;}
+      _frequency.emplace_back(freq);
+
+      // hann windowed sinusoid of q periods centred in the frame,
+      // scaled so a sine of amplitude a reads a / 4, the same as a bin of the windowed fft
+      std::size_t const length {std::min(size, static_cast<std::size_t>(std::ceil(q * sample_rate / freq)))};
+      std::size_t const offset {(size - length) / 2};
+      std::fill(temporal.begin(), temporal.end(), std::complex<double>());
+      double sum {0};
+      for (std::size_t n = 0; n < length; ++n) {
+        sum += 0.5 * (1.0 - std::cos(2.0 * M_PI * static_cast<double>(n) / static_cast<double>(length)));
+      }
+      for (std::size_t n = 0; n < length; ++n) {
+        double const w {0.5 * (1.0 - std::cos(2.0 * M_PI * static_cast<double>(n) / static_cast<double>(length)))};
+        temporal[offset + n] = std::polar(w / (2.0 * sum), 2.0 * M_PI * freq * static_cast<double>(offset + n) / sample_rate);
+      }
+      fft(temporal, spectral);
+
+      // keep the significant values over the bins the real fft returns,
+      // conjugated and divided by the size, so the inner product is the correlation with the sinusoid
+      double peak {0};
+      for (std::size_t j = 1; j < half; ++j) {
+        peak = std::max(peak, std::abs(spectral[j]));
+      }
+      for (std::size_t j = 1; j < half; ++j) {
+        if (std::abs(spectral[j]) < threshold * peak) {continue;}
+        auto const v = std::conj(spectral[j]) / static_cast<double>(size);
+        _index.emplace_back(static_cast<std::uint32_t>(j));
+        _re.emplace_back(static_cast<value_type>(v.real()));
+        _im.emplace_back(static_cast<value_type>(v.imag()));
+      }
+      _begin.emplace_back(static_cast<std::uint32_t>(_index.size()));
+    }
+  }
+
+  // true if init was last called with these parameters
+  bool same(double const sample_rate, std::size_t const size, double const low, double const high, std::size_t const octave) const {
+    return _sample_rate == sample_rate && _size == size && _low == low && _high == high && _octave == octave;
+  }
+
+  // number of bins
+  std::size_t size() const {
+    return _frequency.size();
+  }
+
+  // centre frequency of each bin in hz
+  std::vector<double> const& frequencies() const {
+    return _frequency;
+  }
+
+  // magnitude of each bin from the first size / 2 bins of a real fft,
+  // given as their real parts and imaginary parts
+  void magnitude(value_type const* const re, value_type const* const im, value_type* const out) const {
+    std::size_t const bins {size()};
+    for (std::size_t k = 0; k < bins; ++k) {
+      value_type sr {0};
+      value_type si {0};
+      for (std::size_t e = _begin[k], end = _begin[k + 1]; e < end; ++e) {
+        std::size_t const j {_index[e]};
+        sr += _re[e] * re[j] - _im[e] * im[j];
+        si += _re[e] * im[j] + _im[e] * re[j];
+      }
+      out[k] = std::sqrt(sr * sr + si * si);
+    }
+  }
+
+private:
+  double _sample_rate {0};
+  std::size_t _size {0};
+  double _low {0};
+  double _high {0};
+  std::size_t _octave {0};
+  std::vector<double> _frequency;
+  // the values of bin k are [_begin[k], _begin[k + 1])
+  std::vector<std::uint32_t> _begin {0};
+  std::vector<std::uint32_t> _index;
+  std::vector<value_type> _re;
+  std::vector<value_type> _im;
+}; // class Kernel
+
+} // namespace CQT
+
+#endif // APP_CQT_HH
@@ -0,0 +1,360 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef APP_DSP_HH
+#define APP_DSP_HH
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <utility>
+
+// block kernels for the analysis hot path
+// written as plain branchless loops over contiguous memory
+// so that the compiler can vectorize them
+namespace DSP
+{
+
+// scale a signed 16-bit sample to the range [-1, 1]
+template<typename T>
+inline T scale(std::int16_t const x) {
+  T const pos {static_cast<T>(1.0 / 32767.0)};
+  T const neg {static_cast<T>(1.0 / 32768.0)};
+  T const v = static_cast<T>(x);
+  return v * (v > 0 ? pos : neg);
+}
+
+// floating point samples are already in the range [-1, 1]
+template<typename T>
+inline T scale(float const x) {
+  return static_cast<T>(x);
+}
+
+// convert `size` mono samples
+template<typename T, typename In>
+void convert(In const* in, T* out, std::size_t const size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    out[i] = scale<T>(in[i]);
+  }
+}
+
+// convert and split `frames` interleaved stereo frames
+template<typename T, typename In>
+void deinterleave(In const* in, T* left, T* right, std::size_t const frames) {
+  for (std::size_t i = 0; i < frames; ++i) {
+    left[i] = scale<T>(in[2 * i]);
+    right[i] = scale<T>(in[2 * i + 1]);
+  }
+}
+
+// convert and average `frames` interleaved stereo frames into one channel
+template<typename T, typename In>
+void downmix(In const* in, T* out, std::size_t const frames) {
+  for (std::size_t i = 0; i < frames; ++i) {
+    out[i] = T(0.5) * (scale<T>(in[2 * i]) + scale<T>(in[2 * i + 1]));
+  }
+}
+
+// interleave `frames` samples of two channels
+template<typename T>
+void interleave(T const* left, T const* right, T* out, std::size_t const frames) {
+  for (std::size_t i = 0; i < frames; ++i) {
+    out[2 * i] = left[i];
+    out[2 * i + 1] = right[i];
+  }
+}
+
+// multiply `size` samples by the window, writing the result to `out`
+template<typename T>
+void window(T const* in, T const* win, T* out, std::size_t const size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    out[i] = in[i] * win[i];
+  }
+}
+
+// multiply `size` samples by the window, writing the even samples to `even` and the odd samples to `odd`
+// `offset` is the position of the first sample in the frame, `win` starts at that position
+template<typename T>
+void window_deinterleave(T const* in, T const* win, T* even, T* odd, std::size_t const offset, std::size_t const size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    std::size_t const pos {offset + i};
+    (pos % 2 == 0 ? even : odd)[pos / 2] = in[i] * win[i];
+  }
+}
+
+// 10 log10(x) for x >= 0 from the bits of a float, x is floored to the smallest normal float so zero reads about -379dB
+// the exponent is split off with the mantissa moved into [sqrt(1/2), sqrt(2)),
+// where log2(m) = 2 atanh((m - 1) / (m + 1)) / ln 2 is taken to the s^7 term,
+// leaving an error below 2e-7dB before float rounding
+// branchless and free of library calls, so the loops calling it vectorize
+inline float decibels(float const x) {
+  // adding the floor rather than taking the larger value keeps the loop free of branches,
+  // it changes nothing above 1e-30
+  float const v {x + 1.17549435e-38f};
+  std::uint32_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  // bits of sqrt(1/2)
+  std::uint32_t const base {0x3f3504f3u};
+  std::uint32_t const shift {bits - base};
+  auto const exponent = static_cast<std::int32_t>(shift) >> 23;
+  bits -= shift & 0xff800000u;
+  float m;
+  std::memcpy(&m, &bits, sizeof(m));
+  float const s {(m - 1.0f) / (m + 1.0f)};
+  float const s2 {s * s};
+  // 20 / ln 10, 10 log10 2
+  float const k {8.68588963806503655f};
+  float const e {3.01029995663981195f};
+  return static_cast<float>(exponent) * e + s * (k + s2 * (k / 3.0f + s2 * (k / 5.0f + s2 * (k / 7.0f))));
+}
+
+// the same for a double, floored to the smallest normal double so zero reads about -3077dB,
+// the floor changes nothing above 1e-290, and the series is taken to the s^19 term,
+// so a build with OB_DSP_DOUBLE defined keeps double precision through to the decibels
+inline double decibels(double const x) {
+  double const v {x + 2.2250738585072014e-308};
+  std::uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  // bits of sqrt(1/2)
+  std::uint64_t const base {0x3fe6a09e667f3bcdull};
+  std::uint64_t const shift {bits - base};
+  auto const exponent = static_cast<std::int64_t>(shift) >> 52;
+  bits -= shift & 0xfff0000000000000ull;
+  double m;
+  std::memcpy(&m, &bits, sizeof(m));
+  double const s {(m - 1.0) / (m + 1.0)};
+  double const s2 {s * s};
+  // 20 / ln 10, 10 log10 2
+  double const k {8.68588963806503655};
+  double const e {3.01029995663981195};
+  double sum {k / 19.0};
+  for (int j = 17; j > 0; j -= 2) {
+    sum = k / static_cast<double>(j) + s2 * sum;
+  }
+  return static_cast<double>(exponent) * e + s * sum;
+}
+
+// decibels of the power re^2 + im^2 of `size` bins plus `gain` into `out`,
+// with `hold` keeping the larger of that and the value already in `out`
+template<typename T>
+void power_db(T const* re, T const* im, T* out, std::size_t const size, T const gain, bool const hold) {
+  if (hold) {
+    for (std::size_t i = 0; i < size; ++i) {
+      T const db {decibels(re[i] * re[i] + im[i] * im[i]) + gain};
+      out[i] = std::max(out[i], db);
+    }
+    return;
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    out[i] = decibels(re[i] * re[i] + im[i] * im[i]) + gain;
+  }
+}
+
+// decibels of `size` linear magnitudes plus `gain` into `out`, `hold` as above
+template<typename T>
+void magnitude_db(T const* in, T* out, std::size_t const size, T const gain, bool const hold) {
+  if (hold) {
+    for (std::size_t i = 0; i < size; ++i) {
+      out[i] = std::max(out[i], T(2) * decibels(in[i]) + gain);
+    }
+    return;
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    out[i] = T(2) * decibels(in[i]) + gain;
+  }
+}
+
+enum class Window_Type {
+  // 0.5 (1 - cos(2 pi i / size)), periodic so overlapping frames sum to a constant
+  hann,
+  // all ones, for analyses that window the frame themselves
+  rectangular,
+};
+
+// the window of `type` over `size` samples, built once and kept for the life of the process,
+// every channel and analysis of the same type, size and precision shares one read only table
+template<typename T>
+std::shared_ptr<std::vector<T> const> window_table(Window_Type const type, std::size_t const size) {
+  static std::mutex mutex;
+  static std::map<std::pair<Window_Type, std::size_t>, std::shared_ptr<std::vector<T> const>> tables;
+  std::lock_guard<std::mutex> lock {mutex};
+  auto& entry = tables[{type, size}];
+  if (!entry) {
+    std::vector<T> table (size);
+    switch (type) {
+      case Window_Type::hann:
+        for (std::size_t i = 0; i < size; ++i) {
+          table[i] = static_cast<T>(0.5 * (1.0 - std::cos(2.0 * M_PI * static_cast<double>(i) / static_cast<double>(size))));
+        }
+        break;
+      case Window_Type::rectangular:
+        std::fill(table.begin(), table.end(), T(1));
+        break;
+      default:
+        break;
+    }
+    entry = std::make_shared<std::vector<T> const>(std::move(table));
+  }
+  return entry;
+}
+
+// sine oscillator computing `Lanes` consecutive samples per step
+// each lane holds the phasor of one sample and all lanes are rotated by `Lanes` samples at once,
+// the lanes do not depend on each other so the inner loop vectorizes
+template<typename T, std::size_t Lanes = 8>
+class Oscillator {
+public:
+  static constexpr std::size_t lanes {Lanes};
+
+  Oscillator() {
+    frequency(0, 1);
+  }
+
+  // set the frequency, the phase carries on from the current sample
+  void frequency(double const hz, double const rate) {
+    double const w {2.0 * M_PI * hz / rate};
+    double const phase {std::atan2(static_cast<double>(_im[0]), static_cast<double>(_re[0]))};
+    for (std::size_t i = 0; i < Lanes; ++i) {
+      _re[i] = static_cast<T>(std::cos(phase + w * i));
+      _im[i] = static_cast<T>(std::sin(phase + w * i));
+    }
+    _step_re = static_cast<T>(std::cos(w * Lanes));
+    _step_im = static_cast<T>(std::sin(w * Lanes));
+  }
+
+  // add `gain` times the next `size` samples to `out`
+  // `size` must be a multiple of `Lanes`
+  void process(T* out, std::size_t const size, T const gain) {
+    for (std::size_t n = 0; n < size; n += Lanes) {
+      for (std::size_t i = 0; i < Lanes; ++i) {
+        out[n + i] += gain * _im[i];
+        T const re {_re[i] * _step_re - _im[i] * _step_im};
+        T const im {_re[i] * _step_im + _im[i] * _step_re};
+        _re[i] = re;
+        _im[i] = im;
+      }
+    }
+
+    // pull the phasors back onto the unit circle
+    for (std::size_t i = 0; i < Lanes; ++i) {
+      T const r {T(1.5) - T(0.5) * (_re[i] * _re[i] + _im[i] * _im[i])};
+      _re[i] *= r;
+      _im[i] *= r;
+    }
+  }
+
+private:
+  alignas(32) T _re[Lanes] {};
+  alignas(32) T _im[Lanes] {};
+  T _step_re {1};
+  T _step_im {0};
+};
+
+// uniform white noise in the range [-1, 1)
+// `Lanes` independent xorshift generators, one per consecutive sample
+template<typename T, std::size_t Lanes = 8>
+class Noise {
+public:
+  static constexpr std::size_t lanes {Lanes};
+
+  Noise(std::uint32_t const seed = 1) {
+    for (std::size_t i = 0; i < Lanes; ++i) {
+      _state[i] = (seed + static_cast<std::uint32_t>(i)) * 0x9E3779B9u | 1u;
+    }
+  }
+
+  // write `gain` times the next `size` samples to `out`
+  // `size` must be a multiple of `Lanes`
+  void process(T* out, std::size_t const size, T const gain) {
+    T const scale {gain * static_cast<T>(1.0 / 2147483648.0)};
+    for (std::size_t n = 0; n < size; n += Lanes) {
+      for (std::size_t i = 0; i < Lanes; ++i) {
+        auto x = _state[i];
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        _state[i] = x;
+        out[n + i] = scale * static_cast<T>(static_cast<std::int32_t>(x));
+      }
+    }
+  }
+
+private:
+  alignas(32) std::uint32_t _state[Lanes] {};
+};
+
+// filter white noise into pink noise, -3dB per octave
+// Paul Kellett's refined method, accurate to within 0.05dB above 9.2Hz at 44.1kHz
+template<typename T>
+class Pink {
+public:
+  void process(T* data, std::size_t const size) {
+    for (std::size_t i = 0; i < size; ++i) {
+      T const white {data[i]};
+      _b[0] = T(0.99886) * _b[0] + white * T(0.0555179);
+      _b[1] = T(0.99332) * _b[1] + white * T(0.0750759);
+      _b[2] = T(0.96900) * _b[2] + white * T(0.1538520);
+      _b[3] = T(0.86650) * _b[3] + white * T(0.3104856);
+      _b[4] = T(0.55000) * _b[4] + white * T(0.5329522);
+      _b[5] = T(-0.7616) * _b[5] - white * T(0.0168980);
+      data[i] = T(0.11) * (_b[0] + _b[1] + _b[2] + _b[3] + _b[4] + _b[5] + _b[6] + white * T(0.5362));
+      _b[6] = white * T(0.115926);
+    }
+  }
+
+private:
+  T _b[7] {};
+};
+
+} // namespace DSP
+
+#endif // APP_DSP_HH
@@ -60,7 +60,8 @@ namespace Filter
 using namespace std::string_literals;
 
 // TODO pass part instead of width
-void savitzky_golay(std::vector<double>& bars, std::size_t size, std::size_t width, double const threshold) {
+template<typename T>
+void savitzky_golay(std::vector<T>& bars, std::size_t size, std::size_t width, double const threshold) {
   if (width < 3 || width % 2 != 1) {
     throw std::logic_error("savitzky_golay: invalid width '"s + std::to_string(width) + "', width must be odd and >= 3"s);
   }
@@ -72,7 +73,7 @@ void savitzky_golay(std::vector<double>& bars, std::size_t size, std::size_t wid
   }
   auto const c = 1.0 / width;
 
-  OB::ring_vector<double> win (width);
+  OB::ring_vector<T> win (width);
   for (std::size_t i = part; i > 0; --i) {
     win.push(bars[i]);
   }
@@ -95,11 +96,14 @@ void savitzky_golay(std::vector<double>& bars, std::size_t size, std::size_t wid
     }
 
     if (threshold == 0.0 || std::abs(bars[i] - res) < threshold) {
-      bars[i] = res;
+      bars[i] = static_cast<T>(res);
     }
   }
 }
 
+template void savitzky_golay<float>(std::vector<float>& bars, std::size_t size, std::size_t width, double const threshold);
+template void savitzky_golay<double>(std::vector<double>& bars, std::size_t size, std::size_t width, double const threshold);
+
 // TODO optimize more, try to reduce vector size and copying
 // maybe try combining interpolate and decimate steps
 // in a loop, interpolate until buffer has enough values to decimate, max buffer size will then be `std::max(interpolate, decimate)` instead of `out.size() * std::max(interpolate, decimate)`
@@ -0,0 +1,234 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef APP_GOERTZEL_HH
+#define APP_GOERTZEL_HH
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+// bank of goertzel filters tuned to the equal tempered notes, fed sample by sample
+// each filter runs over hann windowed blocks holding the same number of periods of its note,
+// so the blocks halve in length with every octave and each note is resolved like a constant-q bin
+// the window is generated alongside the filter by a second recurrence, so it needs no table for each length
+// a filter publishes the level of its last complete block and starts the next one,
+// the cost is a few operations per note for each sample, independent of any fft size
+namespace Goertzel
+{
+
+template<typename T>
+class Bank {
+public:
+  using value_type = T;
+  using position_type = std::uint64_t;
+
+  // the notes from `low` up to `high` hz, `octave` notes per octave, tuned to `a4` hz,
+  // with blocks cut to at most `limit` samples at `sample_rate`
+  void init(double const sample_rate, double const low, double const high, std::size_t const octave, std::size_t const limit, double const a4 = 440.0) {
+    _sample_rate = sample_rate;
+    _low = low;
+    _high = high;
+    _octave = octave;
+    _limit = limit;
+
+    _frequency.clear();
+    _notes.clear();
+    if (octave == 0 || low <= 0 || high < low) {
+      clear();
+      return;
+    }
+
+    double const scale {static_cast<double>(octave)};
+    double const q {1.0 / (std::pow(2.0, 1.0 / scale) - 1.0)};
+    double const nyquist {sample_rate / 2.0};
+    for (auto tone = std::ceil(scale * std::log2(low / a4));; ++tone) {
+      double const freq {a4 * std::pow(2.0, tone / scale)};
+      if (freq > high || freq >= nyquist) {break;}
+      Note note;
+      note.size = std::clamp(static_cast<std::size_t>(std::round(q * sample_rate / freq)), std::size_t {2}, limit);
+      note.coeff = 2.0 * std::cos(2.0 * M_PI * freq / sample_rate);
+      note.window = std::cos(2.0 * M_PI / static_cast<double>(note.size));
+      _notes.emplace_back(note);
+      _frequency.emplace_back(freq);
+    }
+    clear();
+  }
+
+  // true if init was last called with these parameters
+  bool same(double const sample_rate, double const low, double const high, std::size_t const octave, std::size_t const limit) const {
+    return _sample_rate == sample_rate && _low == low && _high == high && _octave == octave && _limit == limit;
+  }
+
+  // start new blocks, the levels of the last complete blocks are kept
+  void clear() {
+    for (auto& e : _notes) {
+      e.s1 = 0;
+      e.s2 = 0;
+      e.c1 = 1;
+      e.c2 = e.window;
+      e.count = 0;
+    }
+    _position = (std::numeric_limits<position_type>::max)();
+  }
+
+  // position after the last sample seen
+  position_type position() const {
+    return _position;
+  }
+
+  // number of notes
+  std::size_t size() const {
+    return _frequency.size();
+  }
+
+  // centre frequency of each note in hz
+  std::vector<double> const& frequencies() const {
+    return _frequency;
+  }
+
+  // run the filters over `count` samples starting at position `begin`
+  // each filter is a chain of dependent multiply-adds, so four of them run side by side
+  // over the whole block with their states in registers
+  void update(value_type const* const x, std::size_t const count, position_type const begin) {
+    std::size_t k {0};
+    for (; k + lanes <= _notes.size(); k += lanes) {
+      run<lanes>(&_notes[k], x, count);
+    }
+    for (; k < _notes.size(); ++k) {
+      run<1>(&_notes[k], x, count);
+    }
+    _position = begin + count;
+  }
+
+  // level of the last complete block of each note
+  void magnitude(value_type* const out) const {
+    for (std::size_t k = 0; k < _notes.size(); ++k) {
+      out[k] = _notes[k].level;
+    }
+  }
+
+private:
+  struct Note {
+    // block length
+    std::size_t size {0};
+    // 2 cos(w)
+    double coeff {0};
+    // cos(2 pi / size)
+    double window {1};
+    double s1 {0};
+    double s2 {0};
+    // cosine of the window phase at this sample and the one before
+    double c1 {1};
+    double c2 {1};
+    // samples in the current block
+    std::size_t count {0};
+    value_type level {0};
+  };
+
+  static constexpr std::size_t lanes {4};
+
+  template<std::size_t N>
+  static void run(Note* const notes, value_type const* const x, std::size_t const count) {
+    double s1[N];
+    double s2[N];
+    double c1[N];
+    double c2[N];
+    std::size_t n[N];
+    for (std::size_t j = 0; j < N; ++j) {
+      s1[j] = notes[j].s1;
+      s2[j] = notes[j].s2;
+      c1[j] = notes[j].c1;
+      c2[j] = notes[j].c2;
+      n[j] = notes[j].count;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      double const v {static_cast<double>(x[i])};
+      for (std::size_t j = 0; j < N; ++j) {
+        auto& e = notes[j];
+        double const s0 {v * (0.5 - 0.5 * c1[j]) + e.coeff * s1[j] - s2[j]};
+        s2[j] = s1[j];
+        s1[j] = s0;
+        double const c0 {2.0 * e.window * c1[j] - c2[j]};
+        c2[j] = c1[j];
+        c1[j] = c0;
+        if (++n[j] == e.size) {
+          // scaled like a bin of the hann windowed fft, so a sine of amplitude a reads a / 4
+          double const power {std::max(0.0, s1[j] * s1[j] + s2[j] * s2[j] - e.coeff * s1[j] * s2[j])};
+          e.level = static_cast<value_type>(std::sqrt(power) / static_cast<double>(e.size));
+          s1[j] = 0;
+          s2[j] = 0;
+          c1[j] = 1;
+          c2[j] = e.window;
+          n[j] = 0;
+        }
+      }
+    }
+    for (std::size_t j = 0; j < N; ++j) {
+      notes[j].s1 = s1[j];
+      notes[j].s2 = s2[j];
+      notes[j].c1 = c1[j];
+      notes[j].c2 = c2[j];
+      notes[j].count = n[j];
+    }
+  }
+
+  double _sample_rate {0};
+  double _low {0};
+  double _high {0};
+  std::size_t _octave {0};
+  std::size_t _limit {0};
+  std::vector<double> _frequency;
+  std::vector<Note> _notes;
+  position_type _position {(std::numeric_limits<position_type>::max)()};
+}; // class Bank
+
+} // namespace Goertzel
+
+#endif // APP_GOERTZEL_HH
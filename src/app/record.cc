@@ -44,25 +44,16 @@ SOFTWARE.
 */
 
 #include "app/record.hh"
+#include "app/dsp.hh"
 #include "app/util.hh"
+#include "app/source.hh"
 
 #include <cassert>
 
-Record::Record(std::size_t size) : _size {size} {
-  _left.samples.resize(_size, 0);
-  _left.fmtbuf.resize(_size, -120);
-
-  _right.samples.resize(_size, 0);
-  _right.fmtbuf.resize(_size, -120);
-
-  _inbuf.resize(_size);
-  _outbuf.resize(_size);
-
-  _hann.reserve(_size);
-  for (std::size_t i = 0; i < _size; ++i) {
-    _hann.emplace_back(_hann_constant * (1.0 - std::cos(2.0 * M_PI * i / static_cast<value_type>(_size))));
-  }
+#include <algorithm>
 
+Record::Record(std::size_t size) : _hop {size / 2} {
+  this->size(size);
   filter_init();
 }
 
@@ -75,13 +66,16 @@ void Record::process_interval(sf::Time interval) {
 }
 
 unsigned int Record::sample_rate() const {
-  return sf::SoundRecorder::getSampleRate();
+  return static_cast<unsigned int>(_sample_rate);
 }
 
 void Record::sample_rate(unsigned int rate) {
+  if (_source) {rate = _source->sample_rate();}
   _sample_rate = rate;
   assert(_sample_rate != 0);
   assert(_sample_rate >= _low_pass * 2);
+  buffer_init();
+  layout_init();
   filter_init();
 }
 
@@ -94,10 +88,11 @@ bool Record::device(std::string const& name) {
 }
 
 unsigned int Record::channels() const {
-  return sf::SoundRecorder::getChannelCount();
+  return _channels;
 }
 
 void Record::channels(unsigned int count) {
+  _channels = count;
   sf::SoundRecorder::setChannelCount(count);
 }
 
@@ -114,11 +109,56 @@ bool Record::available() {
 }
 
 bool Record::start() {
-  return sf::SoundRecorder::start(_sample_rate);
+  // the capture and analysis threads are idle here, start from an empty history
+  _left.samples.clear();
+  _right.samples.clear();
+  _left.bass.clear();
+  _right.bass.clear();
+  _left.decimator.clear();
+  _right.decimator.clear();
+  _frame_pos = 0;
+  dsp_start();
+  bool const started {_source ? _source->start(*this) : sf::SoundRecorder::start(static_cast<unsigned int>(_sample_rate))};
+  if (_source) {_recording.store(started);}
+  if (!started) {dsp_stop();}
+  return started;
 }
 
 void Record::stop() {
-  sf::SoundRecorder::stop();
+  if (_source) {
+    _source->stop();
+    _recording.store(false);
+  }
+  else {
+    sf::SoundRecorder::stop();
+  }
+  dsp_stop();
+}
+
+void Record::source(std::unique_ptr<Source> src) {
+  _source = std::move(src);
+  if (_source) {
+    _low_pass = std::min<std::size_t>(_low_pass, _source->sample_rate() / 2);
+    sample_rate(_source->sample_rate());
+  }
+}
+
+Source const* Record::source() const {
+  return _source.get();
+}
+
+std::size_t Record::pending() const {
+  auto head = _left.samples.head();
+  if (_channels != 1) {head = std::min(head, _right.samples.head());}
+  return static_cast<std::size_t>(head - _frame_pos.load(std::memory_order_acquire));
+}
+
+std::size_t Record::space() const {
+  auto head = _left.samples.head();
+  if (_channels != 1) {head = std::min(head, _right.samples.head());}
+  auto const backlog = head - _frame_pos.load(std::memory_order_acquire);
+  auto const limit = _left.samples.capacity() - _size;
+  return backlog < limit ? static_cast<std::size_t>(limit - backlog) : 0;
 }
 
 bool Record::recording() const {
@@ -133,26 +173,112 @@ Record::Bands const& Record::bands_right() const {
   return _right.bands;
 }
 
-std::vector<double> const& Record::buffer_left() const {
-  return _left.fmtbuf;
+Record::View<Record::value_type> Record::buffer_left() const {
+  return pass_band(_spectrum.front().left);
 }
 
-std::vector<double> const& Record::buffer_right() const {
-  return _right.fmtbuf;
+Record::View<Record::value_type> Record::buffer_right() const {
+  return pass_band(_spectrum.front().right);
 }
 
-std::vector<double> Record::samples_left() {
-  std::scoped_lock lock {_mutex};
-  return _left.samples;
+std::vector<Record::value_type> Record::samples_left() {
+  return samples_impl(_left);
 }
 
-std::vector<double> Record::samples_right() {
-  std::scoped_lock lock {_mutex};
-  return _right.samples;
+std::vector<Record::value_type> Record::samples_right() {
+  return samples_impl(_right);
+}
+
+std::vector<Record::value_type> Record::samples_impl(Channel const& channel) {
+  std::vector<value_type> samples (_size);
+  bool valid {false};
+  while (!valid) {
+    auto it = samples.begin();
+    valid = channel.samples.read(channel.samples.head(), _size, [&](auto const* ptr, auto const count) {
+      it = std::copy(ptr, ptr + count, it);
+    });
+  }
+  return samples;
 }
 
 std::size_t Record::size() const {
-  return _inbuf.size();
+  return _size;
+}
+
+void Record::size(std::size_t const samples) {
+  // the real input fft works on pairs of samples
+  assert(samples >= 2 && samples % 2 == 0);
+  _size = samples;
+  _hop = std::clamp(_hop, std::size_t {1}, _size);
+
+  buffer_init();
+  layout_init();
+
+  _work.assign(FFT::workspace(_size), 0);
+
+  // the constant-q kernels carry their own windows
+  _hann = DSP::window_table<value_type>(_analysis == Analysis::cqt ? DSP::Window_Type::rectangular : DSP::Window_Type::hann, _size);
+}
+
+Record::Analysis Record::analysis() const {
+  return _analysis;
+}
+
+void Record::analysis(Analysis const type) {
+  _analysis = type;
+  size(_size);
+}
+
+std::size_t Record::octave_scale() const {
+  return _octave_scale;
+}
+
+void Record::octave_scale(std::size_t const bins) {
+  _octave_scale = bins;
+}
+
+std::size_t Record::multirate() const {
+  return _multirate;
+}
+
+void Record::multirate(std::size_t const factor) {
+  assert(factor >= 1);
+  _multirate = factor;
+  _left.decimator.init(factor);
+  _right.decimator.init(factor);
+  buffer_init();
+  layout_init();
+}
+
+bool Record::zoom() const {
+  return _zoom;
+}
+
+void Record::zoom(bool const enabled) {
+  _zoom = enabled;
+  layout_init();
+}
+
+Record::View<double> Record::frequencies() const {
+  auto const& spectrum = _spectrum.front();
+  if (!spectrum.frequency) {return {};}
+  return pass_band(*spectrum.frequency);
+}
+
+std::size_t Record::hop() const {
+  return _hop;
+}
+
+void Record::hop(std::size_t const samples) {
+  _hop = std::clamp(samples, std::size_t {1}, _size);
+}
+
+std::size_t Record::frames() const {
+  return _frames;
+}
+
+std::size_t Record::frames_skipped() const {
+  return _frames_skipped;
 }
 
 std::size_t Record::low_pass() const {
@@ -176,89 +302,498 @@ void Record::high_pass(std::size_t const hz) {
   filter_init();
 }
 
+void Record::buffer_init() {
+  // hold a full window, a partial hop,
+  // and up to one second of samples that have not been analysed yet
+  _left.samples.resize(2 * _size + _sample_rate);
+  _right.samples.resize(2 * _size + _sample_rate);
+  // the bass band holds a full window and the same backlog at the decimated rate
+  std::size_t const bass {_multirate > 1 ? _left.samples.capacity() / _multirate + _size : 0};
+  _left.bass.resize(bass);
+  _right.bass.resize(bass);
+  _frame_pos = 0;
+}
+
+void Record::layout_init() {
+  fft_layout();
+
+  // the constant-q kernels, the sliding dft bins and the goertzel notes are rebuilt for the new layout by the analysis thread
+  _cqt = CQT::Kernel<value_type> {};
+  _left.sdft = SDFT::Bank<value_type> {};
+  _right.sdft = SDFT::Bank<value_type> {};
+  _left.goertzel = Goertzel::Bank<value_type> {};
+  _right.goertzel = Goertzel::Bank<value_type> {};
+  _left.zoom.reset();
+  _right.zoom.reset();
+  _zoomed = false;
+}
+
+void Record::fft_layout() {
+  // fmtbuf holds the bins of the bass band below the crossover followed by the bins of the short window above it
+  // the bass band has `_multirate` times the resolution and is used up to 0.8 of its nyquist frequency,
+  // below the transition band of the decimator
+  std::size_t const bins {_size / 2};
+  double const bin {_sample_rate / static_cast<double>(_size)};
+  _crossover = _multirate > 1 ? bins * 4 / (5 * _multirate) : 0;
+  std::size_t const bass {_multirate * _crossover};
+  std::vector<double> frequency (bass + bins - _crossover);
+  for (std::size_t i = 0; i < bass; ++i) {
+    frequency[i] = bin * static_cast<double>(i) / static_cast<double>(_multirate);
+  }
+  for (std::size_t i = _crossover; i < bins; ++i) {
+    frequency[bass + i - _crossover] = bin * static_cast<double>(i);
+  }
+  bins_init(std::move(frequency));
+}
+
 void Record::process() {
+  _spectrum.update();
+}
+
+void Record::dsp_start() {
+  _cleared = false;
+  _spectrum.for_each([](auto& e) {
+    e.left.clear();
+    e.right.clear();
+  });
+  _published = nullptr;
+  _dsp_running.store(true);
+  _dsp = std::thread([this]() {dsp_run();});
+}
+
+void Record::dsp_stop() {
+  {
+    std::lock_guard<std::mutex> lock {_dsp_mutex};
+    _dsp_running.store(false);
+  }
+  _dsp_cv.notify_one();
+  if (_dsp.joinable()) {_dsp.join();}
+}
+
+void Record::dsp_run() {
+  while (_dsp_running.load()) {
+    {
+      // woken by the capture thread once a hop of samples has arrived,
+      // the timeout covers a wake up sent between the check and the wait
+      std::unique_lock<std::mutex> lock {_dsp_mutex};
+      // the sliding dft and goertzel analyses take samples as soon as they arrive
+      std::size_t const wake {streaming() ? 1 : _hop};
+      _dsp_cv.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+        return !_dsp_running.load() || pending() >= wake;
+      });
+    }
+    if (!_dsp_running.load()) {break;}
+    analyse();
+  }
+}
+
+void Record::analyse() {
+  bool const mono {_channels == 1};
+  auto head = _left.samples.head();
+  if (!mono) {head = std::min(head, _right.samples.head());}
+  // the bass band is pushed after the samples it is decimated from
+  if (_multirate > 1) {
+    head = std::min(head, _left.bass.head() * _multirate);
+    if (!mono) {head = std::min(head, _right.bass.head() * _multirate);}
+  }
+  auto pos = _frame_pos.load(std::memory_order_relaxed);
+
   // check if audio samples are silent
-  // clear the buffers if they are silent
-  static bool cleared {false};
+  // publish a cleared spectrum once if they are silent
+  // and step over the silent frames without analysing them
   if (_silence.load()) {
-    if (!cleared) {
-      _left.fmtbuf.assign(_left.fmtbuf.size(), -120);
-      _right.fmtbuf.assign(_right.fmtbuf.size(), -120);
-      cleared = true;
+    if (!_cleared) {
+      _left.fmtbuf.assign(_frequency.size(), -120);
+      _right.fmtbuf.assign(_frequency.size(), -120);
+      publish();
+      _cleared = true;
     }
+    _frame_pos.store(pos + (head - pos) / _hop * _hop, std::memory_order_release);
+    return;
+  }
+  _cleared = false;
+
+  if (streaming()) {
+    analyse_stream(pos, head);
     return;
   }
-  cleared = false;
+  if (_analysis == Analysis::cqt) {cqt_init();}
+  // the zoom analysis mixes down and decimates every sample up to the head before the frames are taken
+  bool zoomed {true};
+  if (_zoom) {zoom_init();}
+  if (_zoomed) {
+    zoomed = zoom_feed(_left, pos, head);
+    if (!mono) {zoomed = zoom_feed(_right, pos, head) && zoomed;}
+  }
+
+  // skip frames whose samples the capture thread has already overwritten
+  position_type const backlog {_left.samples.capacity() - _size};
+  if (head - pos > backlog) {
+    auto const skip = (head - pos - backlog + _hop - 1) / _hop;
+    pos += skip * _hop;
+    _frames_skipped += skip;
+  }
 
-  if (!_update.load()) {return;}
-  _update.store(false);
+  // analyse a frame for every hop of samples that arrived since the last call
+  // frames sit at fixed sample positions, independent of the capture chunk size and the render rate
+  // the spectrum holds the peak of each bin over all frames since the render thread last took one,
+  // so short transients are not missed when frames arrive faster than they are drawn
+  bool first {_spectrum.consumed()};
+  resume(first);
+  bool analysed {false};
+  while (pos + _hop <= head) {
+    pos += _hop;
+    bool valid {_zoomed ? zoomed && zoom_frame(pos, first) : analyse_frame(pos, false, first)};
+    if (valid && _multirate > 1) {
+      // the frame of the bass band ends at the same sample
+      valid = analyse_frame(pos / _multirate, true, first);
+    }
+    if (valid) {
+      first = false;
+      analysed = true;
+      ++_frames;
+    }
+    else {
+      ++_frames_skipped;
+    }
+    // a paced source waits on this to reuse the ring
+    _frame_pos.store(pos, std::memory_order_release);
+  }
+  _frame_pos.store(pos, std::memory_order_release);
+  if (!analysed) {return;}
+
+  publish();
+}
+
+bool Record::streaming() const {
+  return _analysis == Analysis::sdft || _analysis == Analysis::goertzel;
+}
 
-  if (sf::SoundRecorder::getChannelCount() == 1) {
-    process_left();
+void Record::analyse_stream(position_type const pos, position_type const head) {
+  // every sample since the last call is fed to the bins,
+  // so the spectrum always ends at the newest sample instead of at a hop boundary
+  bool const sdft {_analysis == Analysis::sdft};
+  if (sdft) {sdft_init();} else {goertzel_init();}
+  // the sliding windows are first filled once a full window of samples has arrived
+  if (sdft && head < _size) {
+    _frame_pos.store(head, std::memory_order_release);
+    return;
+  }
+  // every bin is written again, the peaks are not held
+  resume(true);
+  auto const run = [&](Channel& channel) {
+    return sdft ? slide(channel, pos, head) : feed(channel, pos, head);
+  };
+  bool valid {run(_left)};
+  if (_channels != 1) {valid = run(_right) && valid;}
+  _frame_pos.store(head, std::memory_order_release);
+  if (!valid) {
+    ++_frames_skipped;
+    return;
+  }
+  ++_frames;
+
+  auto const store = [&](Channel& channel) {
+    if (sdft) {channel.sdft.magnitude(&_bin_out[0]);} else {channel.goertzel.magnitude(&_bin_out[0]);}
+    DSP::magnitude_db(&_bin_out[0], &channel.fmtbuf[0], channel.fmtbuf.size(), value_type(0), false);
+  };
+  store(_left);
+  if (_channels != 1) {store(_right);}
+  publish();
+}
+
+bool Record::slide(Channel& channel, position_type const pos, position_type const head) {
+  // carry on from the last call if the samples leaving the windows are still in the ring,
+  // else fill the windows again from the last `_size` samples
+  auto& bank = channel.sdft;
+  bool const resume {bank.position() == pos && head - pos + _size <= channel.samples.capacity()};
+  std::size_t const count {resume ? static_cast<std::size_t>(head - pos) : 0};
+  _stream.resize(count + _size);
+  auto it = _stream.begin();
+  bool const valid {channel.samples.read(head, _stream.size(), [&](auto const* ptr, auto const n) {
+    it = std::copy(ptr, ptr + n, it);
+  })};
+  if (!valid) {
+    bank.clear();
+    return false;
+  }
+  if (resume) {
+    bank.update(&_stream[_size], count, pos);
   }
   else {
-    process_left();
-    process_right();
+    bank.restart(&_stream[0], head);
   }
+  return true;
 }
 
-void Record::process_left() {
-  process_impl(_left);
+bool Record::feed(Channel& channel, position_type const pos, position_type const head) {
+  // the filters run on from the last call, after a gap in the samples they start new blocks
+  auto& bank = channel.goertzel;
+  if (bank.position() != pos) {bank.clear();}
+  auto const count = static_cast<std::size_t>(std::min<position_type>(head - pos, channel.samples.capacity()));
+  _stream.resize(count);
+  auto it = _stream.begin();
+  bool const valid {channel.samples.read(head, count, [&](auto const* ptr, auto const n) {
+    it = std::copy(ptr, ptr + n, it);
+  })};
+  if (!valid) {
+    bank.clear();
+    return false;
+  }
+  bank.update(_stream.data(), count, head - count);
+  return true;
 }
 
-void Record::process_right() {
-  process_impl(_right);
+bool Record::analyse_frame(position_type const end, bool const bass, bool const first) {
+  // the frame is windowed into the workspace, transformed in place,
+  // and its magnitudes are read from where the transform left the bins
+  // the bass band fills fmtbuf below the crossover, the short window fills it above
+  value_type* const work {&_work[0]};
+  std::size_t const bins {_size / 2};
+  std::size_t const offset {bass ? 0 : _multirate * _crossover};
+  std::size_t const begin {bass ? 0 : _crossover};
+  std::size_t const stop {bass ? _multirate * _crossover : bins};
+  if (_channels == 1) {
+    // real input fft, half the work and memory of a complex fft
+    if (!window(bass ? _left.bass : _left.samples, end, work, true)) {return false;}
+    value_type const* const out {_fft.real_split(work, _size)};
+    magnitude(_left, out, out + bins, offset, begin, stop, first);
+    return true;
+  }
+  // both channels share one complex fft, left in the real part and right in the imaginary part
+  bool valid {window(bass ? _left.bass : _left.samples, end, work, false)};
+  valid = window(bass ? _right.bass : _right.samples, end, work + _size, false) && valid;
+  if (!valid) {return false;}
+  value_type const* const out {_fft.pair_split(work, _size)};
+  magnitude(_left, out, out + bins, offset, begin, stop, first);
+  magnitude(_right, out + 2 * bins, out + 3 * bins, offset, begin, stop, first);
+  return true;
 }
 
-void Record::process_impl(Channel& channel) {
-  {
-    // apply window function
-    // add samples to fft in buffer
-    // set imaginary part of complex number to zero
-    std::scoped_lock lock {_mutex};
-    for (std::size_t i = 0; i < _size; ++i) {
-      _inbuf[i] = complex_type(channel.samples[i] * _hann[i], 0);
+bool Record::window(OB::spsc_ring<value_type> const& samples, position_type const end, value_type* const out, bool const deinterleave) {
+  // apply window function to the frame ending at `end`
+  // the window is applied while copying out of the ring
+  // the real input fft takes the even samples followed by the odd samples
+  std::size_t offset {0};
+  return samples.read(end, _size, [&](auto const* ptr, auto const count) {
+    if (deinterleave) {
+      DSP::window_deinterleave(ptr, _hann->data() + offset, out, out + _size / 2, offset, count);
     }
+    else {
+      DSP::window(ptr, _hann->data() + offset, &out[offset], count);
+    }
+    offset += count;
+  });
+}
+
+void Record::cqt_init() {
+  // rebuild the kernels when the pass band or the scale changed
+  double const low {static_cast<double>(_high_pass.load())};
+  double const high {static_cast<double>(_low_pass.load())};
+  std::size_t const octave {_octave_scale.load()};
+  if (_cqt.same(_sample_rate, _size, low, high, octave)) {return;}
+  _cqt.init(_sample_rate, _size, low, high, octave);
+  _bin_out.assign(_cqt.size(), 0);
+  bins_init(_cqt.frequencies());
+}
+
+void Record::sdft_init() {
+  // rebuild the bins when the pass band or the scale changed
+  double const low {static_cast<double>(_high_pass.load())};
+  double const high {static_cast<double>(_low_pass.load())};
+  std::size_t const octave {_octave_scale.load()};
+  if (_left.sdft.same(_sample_rate, _size, low, high, octave)) {return;}
+  _left.sdft.init(_sample_rate, _size, low, high, octave);
+  _right.sdft.init(_sample_rate, _size, low, high, octave);
+  _bin_out.assign(_left.sdft.size(), 0);
+  bins_init(_left.sdft.frequencies());
+}
+
+void Record::zoom_init() {
+  // rebuild the bands when the pass band changed
+  double const low {static_cast<double>(_high_pass.load())};
+  double const high {static_cast<double>(_low_pass.load())};
+  if (_left.zoom.same(_sample_rate, _size, low, high)) {return;}
+  _left.zoom.init(_sample_rate, _size, low, high, _left.samples.capacity());
+  _right.zoom.init(_sample_rate, _size, low, high, _left.samples.capacity());
+  // a band too wide to decimate would mix down and transform every sample of the frame as complex values,
+  // more work than the real fft of the frame, which is used instead
+  _zoomed = _left.zoom.factor() > 1;
+  if (!_zoomed) {
+    fft_layout();
+    return;
   }
+  _zoom_hann = DSP::window_table<value_type>(DSP::Window_Type::hann, _left.zoom.size());
+  bins_init(_left.zoom.frequencies());
+}
+
+bool Record::zoom_feed(Channel& channel, position_type const pos, position_type const head) {
+  // carry on from the last call, else start again a full frame and the start up of the decimator
+  // before the oldest frame still to analyse, or at the oldest sample the ring still holds,
+  // at a position the decimated samples line up with
+  auto& band = channel.zoom;
+  position_type from {band.position()};
+  if (from > head || head - from > channel.samples.capacity()) {
+    position_type const factor {band.factor()};
+    position_type const span {_size + band.warmup() * factor};
+    position_type const capacity {channel.samples.capacity()};
+    position_type const oldest {head > capacity ? (head - capacity + factor - 1) / factor * factor : 0};
+    from = std::max(pos > span ? (pos - span) / factor * factor : 0, oldest);
+  }
+  auto const count = static_cast<std::size_t>(head - from);
+  _stream.resize(count);
+  auto it = _stream.begin();
+  bool const valid {channel.samples.read(head, count, [&](auto const* ptr, auto const n) {
+    it = std::copy(ptr, ptr + n, it);
+  })};
+  if (!valid) {
+    band.clear();
+    return false;
+  }
+  band.update(_stream.data(), count, from);
+  return true;
+}
 
-  _fft(_inbuf, _outbuf);
-
-  // calculate magnitude in decibels of each output bin
-  auto size = _outbuf.size() / 2;
-  channel.fmtbuf.resize(size);
-  double const bin {sf::SoundRecorder::getSampleRate() / static_cast<double>(_size)};
-  for (std::size_t i = 0; i <= size; ++i) {
-    channel.fmtbuf[i] = 20.0 * std::log10(std::sqrt(_outbuf[i].real() * _outbuf[i].real() + _outbuf[i].imag() * _outbuf[i].imag()) / ((_outbuf.size() / 2.0) / _hann_constant));
+bool Record::zoom_frame(position_type const end, bool const first) {
+  // the decimated frame is windowed into the workspace and transformed in place by a complex fft,
+  // its bins are stored from the lowest frequency up
+  value_type* const work {&_work[0]};
+  std::size_t const size {_left.zoom.size()};
+  // a sine of amplitude a reads a / 4, half of it is mixed down to the band and half is filtered out
+  value_type const gain {static_cast<value_type>(-20.0 * std::log10(static_cast<double>(size)))};
+  std::size_t const half {size / 2};
+  auto const run = [&](Channel& channel) {
+    if (!channel.zoom.frame(end, _zoom_hann->data(), work, work + size)) {return false;}
+    value_type const* const re {_fft.split(work, size)};
+    value_type const* const im {re + size};
+    // the negative frequencies in the upper half of the fft come first
+    DSP::power_db(re + half, im + half, &channel.fmtbuf[0], size - half, gain, !first);
+    DSP::power_db(re, im, &channel.fmtbuf[size - half], half, gain, !first);
+    return true;
+  };
+  bool const valid {run(_left)};
+  return (_channels == 1 || run(_right)) && valid;
+}
+
+void Record::goertzel_init() {
+  // rebuild the notes when the pass band or the scale changed
+  // the lowest notes are limited to blocks of one second
+  double const low {static_cast<double>(_high_pass.load())};
+  double const high {static_cast<double>(_low_pass.load())};
+  std::size_t const octave {_octave_scale.load()};
+  if (_left.goertzel.same(_sample_rate, low, high, octave, _sample_rate)) {return;}
+  _left.goertzel.init(_sample_rate, low, high, octave, _sample_rate);
+  _right.goertzel.init(_sample_rate, low, high, octave, _sample_rate);
+  _bin_out.assign(_left.goertzel.size(), 0);
+  bins_init(_left.goertzel.frequencies());
+}
+
+void Record::magnitude(Channel& channel, value_type const* const re, value_type const* const im, std::size_t const offset, std::size_t const begin, std::size_t const end, bool const first) {
+  // calculate magnitude in decibels of the output bins from `begin` to `end`,
+  // stored in fmtbuf from `offset`
+  // keep the peak value when more than one frame is analysed at once
+  if (_analysis == Analysis::cqt) {
+    // the kernels are normalized to read the same level as the fft bins
+    _cqt.magnitude(re, im, &_bin_out[0]);
+    DSP::magnitude_db(&_bin_out[0], &channel.fmtbuf[0], channel.fmtbuf.size(), value_type(0), !first);
+    return;
+  }
+  // a hann windowed sine of amplitude a peaks at a * size / 4, so it reads a / 4
+  double const norm {(_size / 2.0) / _hann_constant};
+  value_type const gain {static_cast<value_type>(-20.0 * std::log10(norm))};
+  value_type* const out {channel.fmtbuf.data() + offset - begin};
+  std::size_t from {begin};
+  if (begin == 0) {
+    // bin 0 is real, its imaginary part holds the nyquist bin, which is past the last bin of fmtbuf
+    // a constant of amplitude a sums to twice the peak of a sine, so it is halved to read a / 4 like one
+    value_type const zero {0};
+    DSP::power_db(re, &zero, out, 1, static_cast<value_type>(-20.0 * std::log10(2.0 * norm)), !first);
+    from = 1;
   }
+  if (from < end) {
+    DSP::power_db(re + from, im + from, out + from, end - from, gain, !first);
+  }
+}
 
-  // calculate bands
-  // {
-  //   auto const calc_band = [&](auto& band) {
-  //     band.val = 0;
-  //     std::size_t const begin = static_cast<std::size_t>(band.min / bin);
-  //     std::size_t const end = static_cast<std::size_t>((band.max / bin) + 1);
-  //     for (std::size_t i = begin; i < end && i < channel.fmtbuf.size(); ++i) {
-  //       band.val += channel.fmtbuf[i];
-  //     }
-  //     band.val = band.val / (end - begin);
-  //   };
+std::size_t Record::bin_index(double const hz) const {
+  // index of the bin of fmtbuf holding `hz`
+  double const bin {_sample_rate / static_cast<double>(_size)};
+  if (_zoomed) {
+    if (_frequency.empty() || hz < _frequency.front()) {return 0;}
+    return std::min(_frequency.size(), static_cast<std::size_t>((hz - _frequency.front()) / bin));
+  }
+  std::size_t const bass {_multirate * _crossover};
+  if (hz < bin * static_cast<double>(_crossover)) {
+    return static_cast<std::size_t>(hz * static_cast<double>(_multirate) / bin);
+  }
+  return std::min(_frequency.size(), bass + static_cast<std::size_t>(hz / bin) - _crossover);
+}
 
-  //   calc_band(channel.bands.sub_bass);
-  //   calc_band(channel.bands.bass);
-  //   calc_band(channel.bands.low_midrange);
-  //   calc_band(channel.bands.midrange);
-  //   calc_band(channel.bands.upper_midrange);
-  //   calc_band(channel.bands.presence);
-  //   calc_band(channel.bands.brilliance);
-  // }
+std::pair<std::size_t, std::size_t> Record::band() const {
+  // range of fmtbuf inside the pass band
+  // the constant-q bins already span it
+  std::size_t begin {0};
+  std::size_t end {_frequency.size()};
+  if (_trim_bins && _analysis == Analysis::fft) {
+    end = std::min(end, bin_index(_low_pass));
+    begin = std::min(end, bin_index(_high_pass));
+  }
+  return {begin, end};
+}
 
-  if (_trim_bins) {
-    auto low_index = static_cast<long int>(_low_pass / bin);
-    channel.fmtbuf.erase(channel.fmtbuf.begin() + low_index, channel.fmtbuf.end());
+void Record::bins_init(std::vector<double> frequency) {
+  // a new layout of fmtbuf, the pass band is found again when the next spectrum is published
+  _frequency = std::move(frequency);
+  _left.fmtbuf.assign(_frequency.size(), -120);
+  _right.fmtbuf.assign(_frequency.size(), -120);
+  _pass_band.frequency.reset();
+}
 
-    auto high_index = static_cast<long int>(_high_pass / bin);
-    channel.fmtbuf.erase(channel.fmtbuf.begin(), channel.fmtbuf.begin() + high_index);
+void Record::resume(bool const first) {
+  // fmtbuf went to the render thread with the last spectrum, and the buffer it got back holds an older one,
+  // while the last spectrum has not been taken the bins are copied back from it so their peaks carry on
+  std::size_t const size {_frequency.size()};
+  auto const run = [&](Channel& channel, std::vector<value_type> const* const last) {
+    if (!first && last && last->size() == size) {
+      channel.fmtbuf.assign(last->begin(), last->end());
+    }
+    else if (channel.fmtbuf.size() != size) {
+      channel.fmtbuf.assign(size, -120);
+    }
+  };
+  run(_left, _published ? &_published->left : nullptr);
+  if (_channels != 1) {run(_right, _published ? &_published->right : nullptr);}
+}
+
+void Record::publish() {
+  // the back spectrum is owned by this thread until it is published
+  // fmtbuf is swapped into it rather than copied, and the render thread reads the pass band through a view
+  std::size_t const low_pass {_low_pass.load()};
+  std::size_t const high_pass {_high_pass.load()};
+  if (!_pass_band.frequency || _pass_band.low_pass != low_pass || _pass_band.high_pass != high_pass) {
+    auto const [begin, end] = band();
+    _pass_band.low_pass = low_pass;
+    _pass_band.high_pass = high_pass;
+    _pass_band.begin = begin;
+    _pass_band.end = end;
+    _pass_band.frequency = std::make_shared<std::vector<double> const>(_frequency);
   }
+  auto& spectrum = _spectrum.back();
+  std::swap(spectrum.left, _left.fmtbuf);
+  if (_channels != 1) {std::swap(spectrum.right, _right.fmtbuf);}
+  if (spectrum.frequency != _pass_band.frequency) {spectrum.frequency = _pass_band.frequency;}
+  spectrum.begin = _pass_band.begin;
+  spectrum.end = _pass_band.end;
+  _published = &spectrum;
+  _spectrum.publish();
+}
+
+template<typename T>
+Record::View<T> Record::pass_band(std::vector<T> const& bins) const {
+  // the bins of the front spectrum from the pass band, empty for a channel that was not analysed
+  auto const& spectrum = _spectrum.front();
+  if (bins.size() < spectrum.end) {return {};}
+  return {bins.data() + spectrum.begin, spectrum.end - spectrum.begin};
 }
 
 bool Record::onStart() {
@@ -271,52 +806,77 @@ void Record::onStop() {
 }
 
 bool Record::onProcessSamples(sf::Int16 const* samples, std::size_t size) {
-  if (!size) {return true;}
+  ingest(samples, size);
+  return true;
+}
 
-  if (*std::max_element(&samples[0], &samples[size]) == 0) {
-    _silence.store(true);
-    return true;
-  }
+void Record::ingest(std::int16_t const* samples, std::size_t size) {
+  ingest_impl(samples, size);
+}
+
+void Record::ingest(float const* samples, std::size_t size) {
+  ingest_impl(samples, size);
+}
 
-  std::scoped_lock lock {_mutex};
+template<typename T>
+void Record::ingest_impl(T const* samples, std::size_t size) {
+  if (!size) {return;}
 
-  if (sf::SoundRecorder::getChannelCount() == 1) {
-    // shift samples left by chunk size
-    for (std::size_t i = size; i < _size; ++i) {
-      _left.samples[i - size] = _left.samples[i];
-    }
+  // count the zero samples at the end of the input,
+  // it is silent once a whole window holds nothing else
+  // silent samples are still added, so that frames stay at their sample positions
+  unsigned int const input {_source ? _source->channels() : _channels};
+  auto const rbegin = std::make_reverse_iterator(&samples[size]);
+  auto const rend = std::make_reverse_iterator(&samples[0]);
+  auto const zeros = static_cast<std::size_t>(std::find_if(rbegin, rend, [](auto const x) {return x != 0;}) - rbegin);
+  _zeros = (zeros == size ? _zeros : 0) + zeros / input;
 
-    // scale, filter and add new samples
-    double scale_pos {1.0 / 32767.0};
-    double scale_neg {1.0 / 32768.0};
-    for (std::size_t i = 0, p = ((_size - size) - 1); i < size && p < _size; ++i, ++p) {
-      _left.samples[p] = (samples[i] > 0 ? samples[i] * scale_pos : samples[i] * scale_neg);
-      filter(_left, p);
+  // scale, filter and add new samples
+  // each chunk is converted, filtered and pushed to the ring as a block,
+  // the cost scales with the chunk size rather than the window size
+  // a source may have a different channel count than the one analysed,
+  // stereo input is mixed down for mono and mono input is copied for stereo
+  if (_channels == 1) {
+    auto const isize {size / input};
+    _left.chunk.resize(isize);
+    if (input == 1) {
+      DSP::convert(samples, _left.chunk.data(), isize);
     }
+    else {
+      DSP::downmix(samples, _left.chunk.data(), isize);
+    }
+    _filter.process_block(_left.chunk.data(), isize);
+    _left.samples.push(_left.chunk.data(), isize);
+    if (_multirate > 1) {decimate(_left, isize);}
   }
   else {
-    // shift samples left by chunk size
-    auto const isize {size / 2};
-    for (std::size_t i = isize; i < _size; ++i) {
-      _left.samples[i - isize] = _left.samples[i];
-      _right.samples[i - isize] = _right.samples[i];
+    auto const isize {size / input};
+    _left.chunk.resize(isize);
+    _right.chunk.resize(isize);
+    if (input == 1) {
+      DSP::convert(samples, _left.chunk.data(), isize);
+      std::copy(_left.chunk.begin(), _left.chunk.end(), _right.chunk.begin());
     }
-
-    // scale, filter and add new samples
-    double scale_pos {1.0 / 32767.0};
-    double scale_neg {1.0 / 32768.0};
-    for (std::size_t i = 0, p = ((_size - isize) - 1); i < size && p < _size; i += 2, ++p) {
-      _left.samples[p] = (samples[i] > 0 ? samples[i] * scale_pos : samples[i] * scale_neg);
-      _right.samples[p] = (samples[i + 1] > 0 ? samples[i + 1] * scale_pos : samples[i + 1] * scale_neg);
-      filter(_left, p);
-      filter(_right, p);
+    else {
+      DSP::deinterleave(samples, _left.chunk.data(), _right.chunk.data(), isize);
+    }
+    _filter.process_block(_left.chunk.data(), _right.chunk.data(), isize);
+    _left.samples.push(_left.chunk.data(), isize);
+    _right.samples.push(_right.chunk.data(), isize);
+    if (_multirate > 1) {
+      decimate(_left, isize);
+      decimate(_right, isize);
     }
   }
 
-  _silence.store(false);
-  _update.store(true);
+  _silence.store(_zeros >= _size);
+  _dsp_cv.notify_one();
+}
 
-  return true;
+void Record::decimate(Channel& channel, std::size_t const size) {
+  channel.bass_chunk.resize(size / _multirate + 1);
+  auto const count = channel.decimator.process(channel.chunk.data(), size, channel.bass_chunk.data());
+  channel.bass.push(channel.bass_chunk.data(), count);
 }
 
 void Record::filter_init() {
@@ -325,18 +885,15 @@ void Record::filter_init() {
   double const db_gain {3.0};
   double const shelf_freq {1000.0};
 
-  _left.high_shelf_filter.init(_sample_rate, shelf_freq, s, db_gain);
-  _left.low_pass_filter.init(_sample_rate, _low_pass, q);
-  _left.high_pass_filter.init(_sample_rate, _high_pass, q);
+  Filter::High_Shelf<value_type> high_shelf_filter;
+  Filter::Low_Pass<value_type> low_pass_filter;
+  Filter::High_Pass<value_type> high_pass_filter;
 
-  _right.high_shelf_filter.init(_sample_rate, shelf_freq, s, db_gain);
-  _right.low_pass_filter.init(_sample_rate, _low_pass, q);
-  _right.high_pass_filter.init(_sample_rate, _high_pass, q);
-}
+  high_shelf_filter.init(_sample_rate, shelf_freq, s, db_gain);
+  low_pass_filter.init(_sample_rate, _low_pass, q);
+  high_pass_filter.init(_sample_rate, _high_pass, q);
 
-void Record::filter(Channel& channel, std::size_t const pos) {
-  auto& val = channel.samples[pos];
-  val = channel.high_shelf_filter.process(val);
-  val = channel.low_pass_filter.process(val);
-  val = channel.high_pass_filter.process(val);
+  _filter.set(0, high_shelf_filter.coefficients());
+  _filter.set(1, low_pass_filter.coefficients());
+  _filter.set(2, high_pass_filter.coefficients());
 }
@@ -47,7 +47,14 @@ SOFTWARE.
 #define APP_RECORD_HH
 
 #include "ob/fft.hh"
+#include "ob/aligned.hh"
+#include "ob/ring.hh"
+#include "ob/triple_buffer.hh"
 
+#include "app/cqt.hh"
+#include "app/sdft.hh"
+#include "app/goertzel.hh"
+#include "app/zoom.hh"
 #include "app/filter.hh"
 
 #include <SFML/Audio.hpp>
@@ -55,15 +62,28 @@ SOFTWARE.
 
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 
 #include <mutex>
 #include <atomic>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <complex>
+#include <utility>
+#include <condition_variable>
+
+class Source;
 
 class Record : public sf::SoundRecorder {
 public:
+  // the analysis precision is chosen at build time,
+  // float by default, double with OB_DSP_DOUBLE defined
+#ifdef OB_DSP_DOUBLE
   using value_type = double;
+#else
+  using value_type = float;
+#endif
   using FFT = OB::FFT<value_type>;
   using complex_type = std::complex<value_type>;
 
@@ -85,11 +105,87 @@ public:
 
   struct Channel {
     Bands bands;
-    std::vector<value_type> samples;
+    OB::spsc_ring<value_type> samples;
+    std::vector<value_type> chunk;
+    // the same samples decimated for the bass band, see Record::multirate
+    OB::spsc_ring<value_type> bass;
+    std::vector<value_type> bass_chunk;
+    Filter::Decimator<value_type> decimator;
+    // running bins of the sliding dft analysis
+    SDFT::Bank<value_type> sdft;
+    // running notes of the goertzel analysis
+    Goertzel::Bank<value_type> goertzel;
+    // mixed down and decimated samples of the zoom analysis
+    Zoom::Band<value_type> zoom;
+    // peak of each bin since the last spectrum was taken, not trimmed
     std::vector<value_type> fmtbuf;
-    Filter::Low_Pass low_pass_filter;
-    Filter::High_Pass high_pass_filter;
-    Filter::High_Shelf high_shelf_filter;
+  };
+
+  // read only view over contiguous values
+  template<typename T>
+  class View {
+  public:
+    View() = default;
+
+    View(T const* data, std::size_t const size) : _data {data}, _size {size} {
+    }
+
+    T const* begin() const {
+      return _data;
+    }
+
+    T const* end() const {
+      return _data + _size;
+    }
+
+    T const& front() const {
+      return _data[0];
+    }
+
+    T const& back() const {
+      return _data[_size - 1];
+    }
+
+    T const& operator[](std::size_t const i) const {
+      return _data[i];
+    }
+
+    std::size_t size() const {
+      return _size;
+    }
+
+    bool empty() const {
+      return _size == 0;
+    }
+
+  private:
+    T const* _data {nullptr};
+    std::size_t _size {0};
+  };
+
+  // a published spectrum in decibels, every bin of fmtbuf,
+  // the bins from `begin` to `end` lie inside the pass band
+  struct Spectrum {
+    std::vector<value_type> left;
+    std::vector<value_type> right;
+    // centre frequency of each bin in hz, shared by every spectrum of the same layout
+    std::shared_ptr<std::vector<double> const> frequency;
+    std::size_t begin {0};
+    std::size_t end {0};
+  };
+
+  // how a frame is turned into bins
+  enum class Analysis {
+    // linearly spaced bins of a hann windowed fft
+    fft,
+    // geometrically spaced bins, a constant number per octave, see CQT::Kernel
+    cqt,
+    // the bins of the constant-q analysis from a sliding dft,
+    // updated with every sample as it arrives, see SDFT::Bank
+    sdft,
+    // one bin for each equal tempered note of the octave scale from a bank of goertzel filters,
+    // fed every sample as it arrives, see Goertzel::Bank
+    goertzel,
   };
 
   Record(std::size_t size = 1024);
@@ -108,47 +204,163 @@ public:
   bool start();
   void stop();
 
+  // replace the capture device with another source of samples
+  // the source decides the sample rate, must be called while stopped
+  void source(std::unique_ptr<Source> src);
+  Source const* source() const;
+  // feed interleaved samples, called from the capture or source thread
+  void ingest(std::int16_t const* samples, std::size_t size);
+  void ingest(float const* samples, std::size_t size);
+  // number of samples that can be fed before unanalysed samples are overwritten
+  std::size_t space() const;
+  // number of samples fed that have not been analysed yet
+  std::size_t pending() const;
+
   bool recording() const;
   Bands const& bands_left() const;
   Bands const& bands_right() const;
-  std::vector<double> const& buffer_left() const;
-  std::vector<double> const& buffer_right() const;
-  std::vector<double> samples_left();
-  std::vector<double> samples_right();
+  // views over the pass band of the spectrum taken by the last call to process,
+  // valid until the next call
+  View<value_type> buffer_left() const;
+  View<value_type> buffer_right() const;
+  std::vector<value_type> samples_left();
+  std::vector<value_type> samples_right();
   std::size_t size() const;
+  void size(std::size_t const samples);
+  Analysis analysis() const;
+  // must be called while stopped
+  void analysis(Analysis const type);
+  // bins per octave of the constant-q analysis
+  std::size_t octave_scale() const;
+  void octave_scale(std::size_t const bins);
+  // decimation of the bass band, which is analysed with a window that many times longer
+  // than the rest of the spectrum, 1 analyses a single band, must be called while stopped
+  std::size_t multirate() const;
+  void multirate(std::size_t const factor);
+  // analyse only the pass band, mixed down and decimated to a smaller fft with the same bin spacing,
+  // the fft analysis only, must be called while stopped
+  bool zoom() const;
+  void zoom(bool const enabled);
+  // centre frequency of each bin of the spectrum taken by the last call to process
+  View<double> frequencies() const;
+  std::size_t hop() const;
+  void hop(std::size_t const samples);
+  std::size_t frames() const;
+  std::size_t frames_skipped() const;
   std::size_t low_pass() const;
   void low_pass(std::size_t const hz);
   std::size_t high_pass() const;
   void high_pass(std::size_t const hz);
+  // take the latest spectrum published by the analysis thread
+  // cheap and wait-free, meant to be called once per rendered frame
   void process();
-  void process_left();
-  void process_right();
 
 private:
-  void process_impl(Channel& channel);
+  using position_type = OB::spsc_ring<value_type>::position_type;
+
+  void buffer_init();
+  template<typename T>
+  void ingest_impl(T const* samples, std::size_t size);
+  void dsp_start();
+  void dsp_stop();
+  void dsp_run();
+  void analyse();
+  bool analyse_frame(position_type const end, bool const bass, bool const first);
+  void layout_init();
+  void fft_layout();
+  void cqt_init();
+  void sdft_init();
+  void goertzel_init();
+  bool streaming() const;
+  void analyse_stream(position_type const pos, position_type const head);
+  bool slide(Channel& channel, position_type const pos, position_type const head);
+  bool feed(Channel& channel, position_type const pos, position_type const head);
+  void zoom_init();
+  bool zoom_feed(Channel& channel, position_type const pos, position_type const head);
+  bool zoom_frame(position_type const end, bool const first);
+  void decimate(Channel& channel, std::size_t const size);
+  bool window(OB::spsc_ring<value_type> const& samples, position_type const end, value_type* const out, bool const deinterleave);
+  void magnitude(Channel& channel, value_type const* const re, value_type const* const im, std::size_t const offset, std::size_t const begin, std::size_t const end, bool const first);
+  std::size_t bin_index(double const hz) const;
+  std::pair<std::size_t, std::size_t> band() const;
+  void bins_init(std::vector<double> frequency);
+  void resume(bool const first);
+  void publish();
+  template<typename T>
+  View<T> pass_band(std::vector<T> const& bins) const;
   bool onStart() override;
   void onStop() override;
   bool onProcessSamples(sf::Int16 const* samples, std::size_t size) override;
 
   void filter_init();
-  void filter(Channel& channel, std::size_t const pos);
+  std::vector<value_type> samples_impl(Channel const& channel);
 
-  std::mutex _mutex;
   std::atomic<bool> _silence {true};
-  std::atomic<bool> _update {false};
+  // number of zero samples at the end of the input
+  std::size_t _zeros {0};
   std::atomic<bool> _recording {false};
-  double const _hann_constant {0.5};
-  std::size_t const _size {2048};
+  // gain of the hann window, the mean of its table
+  value_type const _hann_constant {0.5};
+  std::size_t _size {2048};
+  std::size_t _hop {1024};
+  // end position of the last analysed frame
+  std::atomic<position_type> _frame_pos {0};
+  std::atomic<std::size_t> _frames {0};
+  std::atomic<std::size_t> _frames_skipped {0};
   std::size_t _sample_rate {48000};
-  std::size_t _low_pass {20000};
-  std::size_t _high_pass {20};
+  unsigned int _channels {2};
+  std::atomic<std::size_t> _low_pass {20000};
+  std::atomic<std::size_t> _high_pass {20};
+  Analysis _analysis {Analysis::fft};
+  std::atomic<std::size_t> _octave_scale {24};
+  // built and used on the analysis thread
+  CQT::Kernel<value_type> _cqt;
+  // linear magnitudes of the constant-q, sliding dft or goertzel bins
+  std::vector<value_type> _bin_out;
+  // samples read from the ring by the sliding dft, goertzel and zoom analyses
+  std::vector<value_type> _stream;
+  std::size_t _multirate {1};
+  // first bin of the short window above the bass band
+  std::size_t _crossover {0};
+  // centre frequency of each bin of fmtbuf
+  std::vector<double> _frequency;
+  // range of fmtbuf inside the pass band and the frequencies published with it,
+  // found again only when the layout or the pass band changes
+  struct Pass_Band {
+    std::size_t low_pass {0};
+    std::size_t high_pass {0};
+    std::size_t begin {0};
+    std::size_t end {0};
+    std::shared_ptr<std::vector<double> const> frequency;
+  } _pass_band;
+  bool _zoom {false};
+  // the zoom analysis is running, false while the pass band is too wide to decimate
+  bool _zoomed {false};
+  // window of the decimated frames of the zoom analysis
+  std::shared_ptr<std::vector<value_type> const> _zoom_hann;
   bool _trim_bins {true};
+  // high shelf, low pass and high pass sections
+  // both channels are filtered together
+  Filter::Cascade<value_type, 3> _filter;
   FFT _fft;
+  // the one buffer a frame goes through, from windowing to magnitudes
+  OB::aligned_vector<value_type> _work;
   Channel _left;
   Channel _right;
-  std::vector<complex_type> _inbuf;
-  std::vector<complex_type> _outbuf;
-  std::vector<value_type> _hann;
+  // shared with every other analysis of the same size
+  std::shared_ptr<std::vector<value_type> const> _hann;
+  std::unique_ptr<Source> _source;
+
+  // the analysis runs on its own thread, woken as samples arrive,
+  // and hands each spectrum to the render thread through a triple buffer
+  OB::triple_buffer<Spectrum> _spectrum;
+  // the last spectrum handed to the render thread, fmtbuf went with it
+  Spectrum const* _published {nullptr};
+  std::thread _dsp;
+  std::atomic<bool> _dsp_running {false};
+  std::mutex _dsp_mutex;
+  std::condition_variable _dsp_cv;
+  bool _cleared {false};
 };
 
 #endif // APP_RECORD_HH
@@ -0,0 +1,245 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef APP_SDFT_HH
+#define APP_SDFT_HH
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+// sliding dft with a window of its own for each bin, updated with every sample
+// the bins are spaced like the constant-q bins and each window holds the same number of periods,
+// cut to `size` samples, so neighbouring bins overlap and no frequency falls between them
+// each bin uses the modulated form, accumulating the difference between the newest sample
+// and the one leaving its window multiplied by a twiddle taken from a table by absolute sample position,
+// so no rounding error builds up in a recursive rotation
+// the hann window is applied in the frequency domain from the dft bins either side of each bin
+namespace SDFT
+{
+
+template<typename T>
+class Bank {
+public:
+  using value_type = T;
+  using position_type = std::uint64_t;
+
+  // geometrically spaced bins from `low` up to `high` hz, `octave` bins per octave,
+  // with windows of at most `size` samples at `sample_rate`
+  // bins whose windows are cut to the same length may land on the same dft bin, they are kept once
+  void init(double const sample_rate, std::size_t const size, double const low, double const high, std::size_t const octave) {
+    _sample_rate = sample_rate;
+    _size = size;
+    _low = low;
+    _high = high;
+    _octave = octave;
+
+    _frequency.clear();
+    _bins.clear();
+    _re.clear();
+    _im.clear();
+    if (size < 8 || octave == 0 || low <= 0 || high < low) {
+      clear();
+      return;
+    }
+
+    double const q {1.0 / (std::pow(2.0, 1.0 / static_cast<double>(octave)) - 1.0)};
+    double const nyquist {sample_rate / 2.0};
+    for (std::size_t k = 0;; ++k) {
+      double const freq {low * std::pow(2.0, static_cast<double>(k) / static_cast<double>(octave))};
+      if (freq > high || freq >= nyquist) {break;}
+      Bin bin;
+      bin.size = std::clamp(static_cast<std::size_t>(std::ceil(q * sample_rate / freq)), std::size_t {8}, size);
+      bin.index = std::clamp(static_cast<std::size_t>(std::round(freq * static_cast<double>(bin.size) / sample_rate)), std::size_t {1}, bin.size / 2 - 2);
+      if (!_bins.empty() && _bins.back().size == bin.size && _bins.back().index == bin.index) {continue;}
+
+      // windows of the same length share a twiddle table, e^(-2 pi i n / length)
+      if (!_bins.empty() && _bins.back().size == bin.size) {
+        bin.table = _bins.back().table;
+      }
+      else {
+        bin.table = _re.size();
+        for (std::size_t n = 0; n < bin.size; ++n) {
+          double const w {-2.0 * M_PI * static_cast<double>(n) / static_cast<double>(bin.size)};
+          _re.emplace_back(static_cast<value_type>(std::cos(w)));
+          _im.emplace_back(static_cast<value_type>(std::sin(w)));
+        }
+      }
+      _bins.emplace_back(bin);
+      _frequency.emplace_back(static_cast<double>(bin.index) * sample_rate / static_cast<double>(bin.size));
+    }
+    clear();
+  }
+
+  // true if init was last called with these parameters
+  bool same(double const sample_rate, std::size_t const size, double const low, double const high, std::size_t const octave) const {
+    return _sample_rate == sample_rate && _size == size && _low == low && _high == high && _octave == octave;
+  }
+
+  // forget the samples, the next call must be to restart
+  void clear() {
+    for (auto& e : _bins) {
+      std::fill(std::begin(e.re), std::end(e.re), 0.0);
+      std::fill(std::begin(e.im), std::end(e.im), 0.0);
+    }
+    _position = (std::numeric_limits<position_type>::max)();
+  }
+
+  // position after the last sample seen
+  position_type position() const {
+    return _position;
+  }
+
+  // number of bins
+  std::size_t size() const {
+    return _frequency.size();
+  }
+
+  // centre frequency of each bin in hz
+  std::vector<double> const& frequencies() const {
+    return _frequency;
+  }
+
+  // fill the windows from the `size` samples before position `end`, `x` points to the first of them
+  void restart(value_type const* const x, position_type const end) {
+    clear();
+    for (auto& e : _bins) {
+      slide(e, x + (_size - e.size), nullptr, e.size, end - e.size);
+    }
+    _position = end;
+  }
+
+  // slide the windows over `count` samples starting at position `begin`, `x` points to the first of them,
+  // the `size` samples before it must be the ones before position `begin`
+  // each bin runs over the whole block at once to keep its state in registers
+  void update(value_type const* const x, std::size_t const count, position_type const begin) {
+    for (auto& e : _bins) {
+      slide(e, x, x - e.size, count, begin);
+    }
+    _position = begin + count;
+  }
+
+  // magnitude of each bin of its hann windowed window,
+  // scaled like a bin of the windowed fft, so a sine of amplitude a reads a / 4
+  void magnitude(value_type* const out) const {
+    for (std::size_t k = 0; k < _bins.size(); ++k) {
+      auto const& e = _bins[k];
+      // the state of dft bin j is its value rotated back by j times the start of the window,
+      // the neighbours are rotated by one step either way to line up with the centre
+      std::size_t const m {e.table + static_cast<std::size_t>(_position % e.size)};
+      double const rr {_re[m]};
+      double const ri {-_im[m]};
+      double const lr {e.re[0] * rr + e.im[0] * ri};
+      double const li {e.im[0] * rr - e.re[0] * ri};
+      double const hr {e.re[2] * rr - e.im[2] * ri};
+      double const hi {e.im[2] * rr + e.re[2] * ri};
+      double const xr {0.5 * e.re[1] - 0.25 * (lr + hr)};
+      double const xi {0.5 * e.im[1] - 0.25 * (li + hi)};
+      out[k] = static_cast<value_type>(std::sqrt(xr * xr + xi * xi) / static_cast<double>(e.size));
+    }
+  }
+
+private:
+  struct Bin {
+    // window length
+    std::size_t size {0};
+    // dft bin of the centre frequency
+    std::size_t index {0};
+    // offset of the twiddle table
+    std::size_t table {0};
+    // running sums of the dft bins index - 1, index and index + 1
+    double re[3] {};
+    double im[3] {};
+  };
+
+  // `old` points to the samples leaving the window, the window only fills when it is null
+  void slide(Bin& e, value_type const* const x, value_type const* const old, std::size_t const count, position_type const begin) {
+    value_type const* const re {&_re[e.table]};
+    value_type const* const im {&_im[e.table]};
+    std::size_t const step[3] {e.index - 1, e.index, e.index + 1};
+    std::size_t const phase {static_cast<std::size_t>(begin % e.size)};
+    std::size_t p[3];
+    double yr[3];
+    double yi[3];
+    for (std::size_t j = 0; j < 3; ++j) {
+      p[j] = (step[j] * phase) % e.size;
+      yr[j] = e.re[j];
+      yi[j] = e.im[j];
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      double const d {old ? static_cast<double>(x[i]) - static_cast<double>(old[i]) : static_cast<double>(x[i])};
+      for (std::size_t j = 0; j < 3; ++j) {
+        yr[j] += d * re[p[j]];
+        yi[j] += d * im[p[j]];
+        p[j] += step[j];
+        if (p[j] >= e.size) {p[j] -= e.size;}
+      }
+    }
+    for (std::size_t j = 0; j < 3; ++j) {
+      e.re[j] = yr[j];
+      e.im[j] = yi[j];
+    }
+  }
+
+  double _sample_rate {0};
+  std::size_t _size {0};
+  double _low {0};
+  double _high {0};
+  std::size_t _octave {0};
+  std::vector<double> _frequency;
+  std::vector<Bin> _bins;
+  // twiddle tables of each window length, one after another
+  std::vector<value_type> _re;
+  std::vector<value_type> _im;
+  position_type _position {(std::numeric_limits<position_type>::max)()};
+}; // class Bank
+
+} // namespace SDFT
+
+#endif // APP_SDFT_HH
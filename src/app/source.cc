@@ -0,0 +1,476 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "app/source.hh"
+#include "app/record.hh"
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+Source::Source(Pace const pace) : _pace {pace} {
+}
+
+Source::~Source() {
+  stop();
+}
+
+unsigned int Source::sample_rate() const {
+  return _sample_rate;
+}
+
+unsigned int Source::channels() const {
+  return _channels;
+}
+
+Source::Pace Source::pace() const {
+  return _pace;
+}
+
+std::uint64_t Source::frames() const {
+  return _frames.load();
+}
+
+bool Source::done() const {
+  return _done.load();
+}
+
+std::uint64_t Source::underruns() const {
+  return _underruns.load();
+}
+
+std::uint64_t Source::overruns() const {
+  return _overruns.load();
+}
+
+bool Source::running() const {
+  return _running.load();
+}
+
+void Source::underrun() {
+  _underruns.fetch_add(1);
+}
+
+bool Source::start(Record& rec) {
+  stop();
+  _done.store(false);
+  _running.store(true);
+  _thread = std::thread([this, &rec]() {run(rec);});
+  return true;
+}
+
+void Source::stop() {
+  _running.store(false);
+  if (_thread.joinable()) {_thread.join();}
+}
+
+void Source::run(Record& rec) {
+  using clock = std::chrono::steady_clock;
+
+  // feed blocks of 10ms at realtime pace,
+  // and blocks as large as the free space in the ring allows when running fast
+  std::size_t const block {_pace == Pace::realtime ? std::max(1u, _sample_rate / 100) : 4096};
+  auto const begin = clock::now();
+  std::uint64_t fed {0};
+
+  while (_running.load()) {
+    std::size_t frames {block};
+    if (_pace == Pace::fast) {
+      // wait for the analysis to catch up instead of overwriting samples it has not read yet
+      std::size_t space {0};
+      while (_running.load() && (space = rec.space()) < std::min(block, std::size_t {1024})) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      if (!_running.load()) {break;}
+      frames = std::min(frames, space);
+    }
+    else if (rec.space() < frames) {
+      _overruns.fetch_add(1);
+    }
+
+    auto const n = read(rec, frames);
+    if (n == 0) {
+      // a read cut short by stop is not the end of the input
+      _done.store(_running.load());
+      break;
+    }
+    fed += n;
+    _frames.fetch_add(n);
+
+    if (_pace == Pace::realtime) {
+      std::this_thread::sleep_until(begin + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(fed / static_cast<double>(_sample_rate))));
+    }
+  }
+}
+
+File_Source::File_Source(std::string const& path, Pace const pace) : Source {pace}, _path {path} {
+  int const fd {::open(_path.c_str(), O_RDONLY)};
+  if (fd < 0) {
+    throw std::runtime_error("could not open '" + _path + "'");
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < 12) {
+    ::close(fd);
+    throw std::runtime_error("'" + _path + "' is not a wav file");
+  }
+  _map_size = static_cast<std::size_t>(st.st_size);
+
+  // the mapping stays valid after the descriptor is closed
+  void* map {::mmap(nullptr, _map_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    throw std::runtime_error("could not map '" + _path + "'");
+  }
+  ::madvise(map, _map_size, MADV_SEQUENTIAL);
+  _map = static_cast<unsigned char const*>(map);
+
+  try {
+    parse();
+  }
+  catch (...) {
+    ::munmap(const_cast<unsigned char*>(_map), _map_size);
+    throw;
+  }
+}
+
+File_Source::~File_Source() {
+  // the thread reads from the mapping, join it before unmapping
+  stop();
+  ::munmap(const_cast<unsigned char*>(_map), _map_size);
+}
+
+std::uint64_t File_Source::length() const {
+  return _data_size / (_channels * (_format == Format::s16 ? 2 : 4));
+}
+
+void File_Source::parse() {
+  auto const u16 = [&](std::size_t const off) -> std::uint32_t {
+    return static_cast<std::uint32_t>(_map[off] | (_map[off + 1] << 8));
+  };
+  auto const u32 = [&](std::size_t const off) -> std::uint32_t {
+    return u16(off) | (u16(off + 2) << 16);
+  };
+  auto const error = [&](std::string const& msg) {
+    return std::runtime_error("'" + _path + "' " + msg);
+  };
+
+  if (std::memcmp(_map, "RIFF", 4) != 0 || std::memcmp(_map + 8, "WAVE", 4) != 0) {
+    throw error("is not a wav file");
+  }
+
+  // walk the chunks until the sample data, chunks are padded to an even size
+  bool fmt {false};
+  std::size_t pos {12};
+  while (pos + 8 <= _map_size) {
+    auto const* id = _map + pos;
+    std::size_t const size {u32(pos + 4)};
+    pos += 8;
+
+    if (std::memcmp(id, "fmt ", 4) == 0) {
+      if (size < 16 || pos + size > _map_size) {throw error("has an invalid format chunk");}
+      auto tag = u16(pos);
+      _channels = u16(pos + 2);
+      _sample_rate = u32(pos + 4);
+      auto const bits = u16(pos + 14);
+      // extensible format, the tag is the start of the sub format guid
+      if (tag == 0xFFFE && size >= 26) {tag = u16(pos + 24);}
+
+      if (tag == 1 && bits == 16) {
+        _format = Format::s16;
+      }
+      else if (tag == 3 && bits == 32) {
+        _format = Format::f32;
+      }
+      else {
+        throw error("is not 16-bit pcm or 32-bit float");
+      }
+      if (_channels < 1 || _channels > 2) {throw error("is not mono or stereo");}
+      if (_sample_rate == 0) {throw error("has an invalid sample rate");}
+      fmt = true;
+    }
+    else if (std::memcmp(id, "data", 4) == 0) {
+      if (!fmt) {throw error("has no format chunk");}
+      // truncated files and streamed files with an unknown size read up to the end of the file
+      _data = pos;
+      _data_size = std::min(size, _map_size - pos);
+      break;
+    }
+
+    pos += size + (size & 1);
+  }
+
+  if (!_data) {throw error("has no sample data");}
+}
+
+std::size_t File_Source::read(Record& rec, std::size_t const frames) {
+  auto const count = static_cast<std::size_t>(std::min<std::uint64_t>(frames, length() - _offset));
+  if (!count) {return 0;}
+
+  // samples are little endian, the same as the host
+  auto const size = count * _channels;
+  if (_format == Format::s16) {
+    rec.ingest(reinterpret_cast<std::int16_t const*>(_map + _data) + _offset * _channels, size);
+  }
+  else if ((_data % alignof(float)) == 0) {
+    rec.ingest(reinterpret_cast<float const*>(_map + _data) + _offset * _channels, size);
+  }
+  else {
+    // the data chunk is only guaranteed to be 2 byte aligned
+    _stage.resize(size);
+    std::memcpy(_stage.data(), _map + _data + _offset * _channels * sizeof(float), size * sizeof(float));
+    rec.ingest(_stage.data(), size);
+  }
+  _offset += count;
+
+  return count;
+}
+
+Stream_Source::Format Stream_Source::format(std::string const& name) {
+  if (name == "s16le") {return Format::s16le;}
+  if (name == "f32le") {return Format::f32le;}
+  throw std::runtime_error("unknown format '" + name + "'");
+}
+
+bool Stream_Source::is_stream(std::string const& path) {
+  if (path == "-") {return true;}
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+Stream_Source::Stream_Source(std::string const& path, Format const format, unsigned int const rate, unsigned int const channels, Pace const pace) : Source {pace}, _path {path}, _format {format} {
+  _sample_rate = rate;
+  _channels = channels;
+  _frame_bytes = _channels * (_format == Format::s16le ? sizeof(std::int16_t) : sizeof(float));
+  _stage = std::make_unique<float[]>(stage_frames * _frame_bytes / sizeof(float) + 1);
+
+  if (_path == "-") {
+    _fd = STDIN_FILENO;
+  }
+  else {
+    // blocks until the pipe has a writer
+    _fd = ::open(_path.c_str(), O_RDONLY);
+    if (_fd < 0) {
+      throw std::runtime_error("could not open '" + _path + "'");
+    }
+  }
+
+  _flags = ::fcntl(_fd, F_GETFL);
+  ::fcntl(_fd, F_SETFL, _flags | O_NONBLOCK);
+}
+
+Stream_Source::~Stream_Source() {
+  stop();
+  ::fcntl(_fd, F_SETFL, _flags);
+  if (_fd != STDIN_FILENO) {::close(_fd);}
+}
+
+std::size_t Stream_Source::read(Record& rec, std::size_t const frames) {
+  auto* const stage = reinterpret_cast<unsigned char*>(_stage.get());
+  std::size_t const want {std::min(frames, stage_frames) * _frame_bytes};
+
+  // read until at least one whole frame is ready
+  // a read may end partway through a frame, the rest arrives with the next read
+  while (_fill < _frame_bytes) {
+    auto const n = ::read(_fd, stage + _fill, want - _fill);
+    if (n > 0) {
+      _fill += static_cast<std::size_t>(n);
+      _stalled = false;
+      continue;
+    }
+    if (n == 0) {return 0;}
+    if (errno == EINTR) {continue;}
+#if EAGAIN != EWOULDBLOCK
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {return 0;}
+#else
+    if (errno != EAGAIN) {return 0;}
+#endif
+
+    // nothing to read, wait for the writer while staying responsive to stop
+    if (!running()) {return 0;}
+    pollfd pfd {_fd, POLLIN, 0};
+    if (::poll(&pfd, 1, 50) == 0 && !_stalled) {
+      // count each stall once, not each time the wait times out
+      _stalled = true;
+      underrun();
+    }
+  }
+
+  auto const count = _fill / _frame_bytes;
+  auto const bytes = count * _frame_bytes;
+  if (_format == Format::s16le) {
+    rec.ingest(reinterpret_cast<std::int16_t const*>(stage), count * _channels);
+  }
+  else {
+    rec.ingest(reinterpret_cast<float const*>(stage), count * _channels);
+  }
+  _fill -= bytes;
+  std::memmove(stage, stage + bytes, _fill);
+
+  return count;
+}
+
+Synth_Source::Signal Synth_Source::signal(std::string const& name) {
+  if (name == "sweep") {return Signal::sweep;}
+  if (name == "tones") {return Signal::tones;}
+  if (name == "impulse") {return Signal::impulse;}
+  if (name == "pink") {return Signal::pink;}
+  if (name == "white") {return Signal::white;}
+  throw std::runtime_error("unknown signal '" + name + "'");
+}
+
+Synth_Source::Synth_Source(Signal const signal, unsigned int const rate, unsigned int const channels, std::uint64_t const length, Pace const pace) : Source {pace}, _signal {signal}, _length {length} {
+  _sample_rate = rate;
+  _channels = channels;
+
+  // a major, spread over three octaves
+  std::array<double, 4> const chord {110.0, 277.18, 329.63, 880.0};
+  for (std::size_t i = 0; i < _osc.size(); ++i) {
+    _osc[i].frequency(chord[i], _sample_rate);
+  }
+}
+
+std::size_t Synth_Source::read(Record& rec, std::size_t const frames) {
+  // generate whole steps of the block generators
+  std::size_t const lanes {Oscillator::lanes};
+  std::size_t size {std::max(lanes, frames - frames % lanes)};
+  if (_length) {
+    if (_pos >= _length) {return 0;}
+    size = static_cast<std::size_t>(std::min<std::uint64_t>(size, _length - _pos));
+  }
+  // the tail of a finite signal may not fill a whole step
+  std::size_t const steps {(size + lanes - 1) / lanes * lanes};
+
+  bool const stereo {_channels == 2};
+  _left.assign(steps, 0);
+  if (stereo) {_right.resize(steps);}
+
+  switch (_signal) {
+    case Signal::sweep: {
+      sweep(steps);
+      if (stereo) {std::copy(_left.begin(), _left.end(), _right.begin());}
+      break;
+    }
+
+    case Signal::tones: {
+      for (auto& osc : _osc) {
+        osc.process(_left.data(), steps, 0.2f);
+      }
+      if (stereo) {std::copy(_left.begin(), _left.end(), _right.begin());}
+      break;
+    }
+
+    case Signal::impulse: {
+      impulse(steps);
+      if (stereo) {std::copy(_left.begin(), _left.end(), _right.begin());}
+      break;
+    }
+
+    case Signal::pink: {
+      _noise_left.process(_left.data(), steps, 1.0f);
+      _pink_left.process(_left.data(), steps);
+      if (stereo) {
+        _noise_right.process(_right.data(), steps, 1.0f);
+        _pink_right.process(_right.data(), steps);
+      }
+      break;
+    }
+
+    case Signal::white: {
+      _noise_left.process(_left.data(), steps, 0.5f);
+      if (stereo) {_noise_right.process(_right.data(), steps, 0.5f);}
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+
+  if (stereo) {
+    _buf.resize(2 * size);
+    DSP::interleave(_left.data(), _right.data(), _buf.data(), size);
+    rec.ingest(_buf.data(), _buf.size());
+  }
+  else {
+    rec.ingest(_left.data(), size);
+  }
+  _pos += size;
+
+  return size;
+}
+
+void Synth_Source::sweep(std::size_t const size) {
+  // the frequency is held over short segments and stepped between them
+  std::size_t const segment {256};
+  double const duration {10.0};
+  double const begin {20.0};
+  double const end {std::min(20000.0, 0.45 * _sample_rate)};
+  auto const period = static_cast<std::uint64_t>(duration * _sample_rate);
+
+  for (std::size_t n = 0; n < size; n += segment) {
+    auto const count = std::min(segment, size - n);
+    double const t {static_cast<double>((_pos + n + count / 2) % period) / _sample_rate};
+    _osc[0].frequency(begin * std::pow(end / begin, t / duration), _sample_rate);
+    _osc[0].process(&_left[n], count, 0.5f);
+  }
+}
+
+void Synth_Source::impulse(std::size_t const size) {
+  std::uint64_t const period {_sample_rate / 2};
+  // first impulse at or after the current position
+  for (auto i = (_pos + period - 1) / period * period; i < _pos + size; i += period) {
+    _left[static_cast<std::size_t>(i - _pos)] = 1.0f;
+  }
+}
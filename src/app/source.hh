@@ -0,0 +1,238 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef APP_SOURCE_HH
+#define APP_SOURCE_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "app/dsp.hh"
+
+class Record;
+
+// an audio source that stands in for the capture device
+// samples are fed to the record from a thread owned by the source,
+// the same way the capture thread feeds them
+class Source {
+public:
+  enum class Pace {
+    // feed samples at the rate they would be captured
+    realtime,
+    // feed samples as fast as the analysis keeps up with them
+    fast,
+  };
+
+  Source(Pace const pace = Pace::realtime);
+  virtual ~Source();
+
+  Source(Source const&) = delete;
+  Source& operator=(Source const&) = delete;
+
+  unsigned int sample_rate() const;
+  unsigned int channels() const;
+  Pace pace() const;
+  // total number of frames fed to the record
+  std::uint64_t frames() const;
+  // true once the end of the input has been reached
+  bool done() const;
+  // times the input had no samples ready when they were due
+  std::uint64_t underruns() const;
+  // times samples were fed before the analysis had read the ones they replace
+  std::uint64_t overruns() const;
+
+  bool start(Record& rec);
+  void stop();
+
+protected:
+  // feed up to `frames` frames to the record
+  // returns the number of frames fed, 0 at the end of the input
+  virtual std::size_t read(Record& rec, std::size_t const frames) = 0;
+
+  // false once the source has been asked to stop
+  bool running() const;
+  void underrun();
+
+  unsigned int _sample_rate {48000};
+  unsigned int _channels {2};
+
+private:
+  void run(Record& rec);
+
+  Pace const _pace;
+  std::thread _thread;
+  std::atomic<bool> _running {false};
+  std::atomic<bool> _done {false};
+  std::atomic<std::uint64_t> _frames {0};
+  std::atomic<std::uint64_t> _underruns {0};
+  std::atomic<std::uint64_t> _overruns {0};
+};
+
+// a wav file mapped into memory
+// samples are fed straight from the mapping, the file is never copied to the heap
+class File_Source : public Source {
+public:
+  File_Source(std::string const& path, Pace const pace = Pace::realtime);
+  ~File_Source();
+
+  // length of the input in frames
+  std::uint64_t length() const;
+
+protected:
+  std::size_t read(Record& rec, std::size_t const frames) override;
+
+private:
+  void parse();
+
+  enum class Format {
+    s16,
+    f32,
+  };
+
+  std::string _path;
+  unsigned char const* _map {nullptr};
+  std::size_t _map_size {0};
+  Format _format {Format::s16};
+  // offset and size in bytes of the sample data
+  std::size_t _data {0};
+  std::size_t _data_size {0};
+  // read offset in frames
+  std::uint64_t _offset {0};
+  // used when float samples are not aligned in the mapping
+  std::vector<float> _stage;
+};
+
+// raw interleaved pcm read from stdin or a named pipe
+// the input decides the pace, reads are non-blocking into a fixed staging buffer
+// and go straight to the record from there
+class Stream_Source : public Source {
+public:
+  enum class Format {
+    s16le,
+    f32le,
+  };
+
+  // parse a format name, throws on an unknown name
+  static Format format(std::string const& name);
+  // true if `path` names stdin or a named pipe
+  static bool is_stream(std::string const& path);
+
+  // a `path` of '-' reads from stdin
+  Stream_Source(std::string const& path, Format const format, unsigned int const rate, unsigned int const channels, Pace const pace = Pace::realtime);
+  ~Stream_Source();
+
+protected:
+  std::size_t read(Record& rec, std::size_t const frames) override;
+
+private:
+  // size of the staging buffer in frames
+  static constexpr std::size_t stage_frames {4096};
+
+  std::string _path;
+  Format const _format;
+  int _fd {-1};
+  int _flags {0};
+  std::size_t _frame_bytes {0};
+  // float storage keeps the staging buffer aligned for either format
+  std::unique_ptr<float[]> _stage;
+  // bytes of a partial frame left at the front of the staging buffer
+  std::size_t _fill {0};
+  bool _stalled {false};
+};
+
+// generated test signals, for use without a recording device
+// samples are computed in blocks, fast enough to drive the analysis far beyond realtime
+class Synth_Source : public Source {
+public:
+  enum class Signal {
+    // logarithmic sine sweep from 20Hz to near nyquist, repeated every 10 seconds
+    sweep,
+    // a chord of sine tones
+    tones,
+    // a single sample impulse twice a second
+    impulse,
+    // noise with equal power per octave
+    pink,
+    // noise with equal power per frequency
+    white,
+  };
+
+  // parse a signal name, throws on an unknown name
+  static Signal signal(std::string const& name);
+
+  // a `length` of 0 frames never ends
+  Synth_Source(Signal const signal, unsigned int const rate, unsigned int const channels, std::uint64_t const length = 0, Pace const pace = Pace::realtime);
+
+protected:
+  std::size_t read(Record& rec, std::size_t const frames) override;
+
+private:
+  using Oscillator = DSP::Oscillator<float>;
+
+  void sweep(std::size_t const size);
+  void impulse(std::size_t const size);
+
+  Signal const _signal;
+  std::uint64_t const _length;
+  // frames generated so far
+  std::uint64_t _pos {0};
+  std::array<Oscillator, 4> _osc;
+  DSP::Noise<float> _noise_left {1};
+  DSP::Noise<float> _noise_right {2};
+  DSP::Pink<float> _pink_left;
+  DSP::Pink<float> _pink_right;
+  std::vector<float> _left;
+  std::vector<float> _right;
+  std::vector<float> _buf;
+};
+
+#endif // APP_SOURCE_HH
@@ -0,0 +1,232 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef APP_ZOOM_HH
+#define APP_ZOOM_HH
+
+#include "ob/ring.hh"
+
+#include "app/filter.hh"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+// zoom analysis of a band far narrower than the sample rate
+// the samples are mixed down so the centre of the band sits at 0 hz, then low passed and decimated as a complex signal,
+// a complex fft of `size / factor` decimated samples spans the same time as `size` samples,
+// so it has the same bin spacing inside the band for a fraction of the work
+namespace Zoom
+{
+
+template<typename T>
+class Band {
+public:
+  using value_type = T;
+  using position_type = std::uint64_t;
+
+  // the band from `low` to `high` hz of frames of `size` samples at `sample_rate`,
+  // keeping up to `backlog` samples of decimated history
+  // the factor is the largest power of two dividing `size` that leaves the band inside 0.8 of the decimated rate,
+  // where the decimator is flat, and leaves at least 64 decimated samples in a frame
+  void init(double const sample_rate, std::size_t const size, double const low, double const high, std::size_t const backlog) {
+    _sample_rate = sample_rate;
+    _size = size;
+    _low = low;
+    _high = high;
+
+    _factor = 1;
+    while (size % (_factor * 2) == 0 && size / (_factor * 2) >= 64 && 0.8 * sample_rate / static_cast<double>(_factor * 2) >= high - low) {
+      _factor *= 2;
+    }
+    _bins = size / _factor;
+    _rate = sample_rate / static_cast<double>(_factor);
+    _centre = (low + high) / 2.0;
+
+    _re.decimator.init(_factor);
+    _im.decimator.init(_factor);
+    _warmup = (_re.decimator.taps() + _factor - 1) / _factor;
+    _re.samples.resize(backlog / _factor + _bins);
+    _im.samples.resize(backlog / _factor + _bins);
+
+    // the bins in order of frequency, the negative frequencies of the fft first
+    _frequency.resize(_bins);
+    for (std::size_t i = 0; i < _bins; ++i) {
+      _frequency[i] = _centre + (static_cast<double>(i) - static_cast<double>(_bins / 2)) * _rate / static_cast<double>(_bins);
+    }
+    clear();
+  }
+
+  // true if init was last called with these parameters
+  bool same(double const sample_rate, std::size_t const size, double const low, double const high) const {
+    return _sample_rate == sample_rate && _size == size && _low == low && _high == high;
+  }
+
+  // make the next call to same return false, the band holds rings and is not copied
+  void reset() {
+    _size = 0;
+  }
+
+  // forget the samples, the next update must start at a multiple of the factor
+  void clear() {
+    _re.decimator.clear();
+    _im.decimator.clear();
+    _re.samples.clear();
+    _im.samples.clear();
+    _offset = 0;
+    _position = (std::numeric_limits<position_type>::max)();
+  }
+
+  // position after the last sample seen
+  position_type position() const {
+    return _position;
+  }
+
+  std::size_t factor() const {
+    return _factor;
+  }
+
+  // number of decimated samples after a restart that still hold the start up of the decimator
+  std::size_t warmup() const {
+    return _warmup;
+  }
+
+  // number of decimated samples in a frame, and of bins
+  std::size_t size() const {
+    return _bins;
+  }
+
+  // centre frequency of each bin in hz
+  std::vector<double> const& frequencies() const {
+    return _frequency;
+  }
+
+  // mix down and decimate `count` samples starting at position `begin`
+  void update(value_type const* const x, std::size_t const count, position_type const begin) {
+    if (_position != begin) {
+      clear();
+      _offset = begin / _factor;
+    }
+
+    // the oscillator starts from the exact phase of the absolute position of the first sample,
+    // so a block carries no error over from the one before it
+    double const cycles {std::fmod(_centre / _sample_rate * static_cast<double>(begin), 1.0)};
+    double cr {std::cos(2.0 * M_PI * cycles)};
+    double ci {-std::sin(2.0 * M_PI * cycles)};
+    double const wr {std::cos(2.0 * M_PI * _centre / _sample_rate)};
+    double const wi {-std::sin(2.0 * M_PI * _centre / _sample_rate)};
+    _re.chunk.resize(count);
+    _im.chunk.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      _re.chunk[i] = static_cast<value_type>(x[i] * cr);
+      _im.chunk[i] = static_cast<value_type>(x[i] * ci);
+      double const r {cr * wr - ci * wi};
+      ci = cr * wi + ci * wr;
+      cr = r;
+    }
+
+    decimate(_re, count);
+    decimate(_im, count);
+    _position = begin + count;
+  }
+
+  // the decimated frame ending at input position `end` into `re` and `im`, multiplied by `window`
+  // returns false if its samples have not been seen, were already overwritten, or hold the start up of the decimator
+  bool frame(position_type const end, value_type const* const window, value_type* const re, value_type* const im) const {
+    position_type const last {end / _factor};
+    // a band started at the first sample needs no warm up, the samples before it are zero as the decimator assumes,
+    // and read as zero from the rings as the samples of the fft analysis do
+    position_type const settled {_offset == 0 ? 0 : _offset + _warmup + _bins};
+    if (last < settled || last > _offset + _re.samples.head()) {return false;}
+    auto const copy = [&](Lane const& lane, value_type* const out) {
+      std::size_t offset {0};
+      return lane.samples.read(last - _offset, _bins, [&](auto const* ptr, auto const count) {
+        for (std::size_t i = 0; i < count; ++i) {
+          out[offset + i] = ptr[i] * window[offset + i];
+        }
+        offset += count;
+      });
+    };
+    return copy(_re, re) && copy(_im, im);
+  }
+
+private:
+  struct Lane {
+    Filter::Decimator<value_type> decimator;
+    OB::spsc_ring<value_type> samples;
+    std::vector<value_type> chunk;
+    std::vector<value_type> out;
+  };
+
+  void decimate(Lane& lane, std::size_t const count) {
+    lane.out.resize(count / _factor + 1);
+    auto const n = lane.decimator.process(lane.chunk.data(), count, lane.out.data());
+    lane.samples.push(lane.out.data(), n);
+  }
+
+  double _sample_rate {0};
+  std::size_t _size {0};
+  double _low {0};
+  double _high {0};
+  std::size_t _factor {1};
+  std::size_t _bins {0};
+  std::size_t _warmup {0};
+  double _rate {0};
+  double _centre {0};
+  std::vector<double> _frequency;
+  Lane _re;
+  Lane _im;
+  // decimated position of the first decimated sample in the rings
+  position_type _offset {0};
+  position_type _position {(std::numeric_limits<position_type>::max)()};
+}; // class Band
+
+} // namespace Zoom
+
+#endif // APP_ZOOM_HH
@@ -63,7 +63,15 @@ inline void program_init(OB::Parg& pg) {
   pg.name("octavia").version("0.1.2 (04.10.2020)");
   pg.description("octobanana's customizable text-based audio visualization interactive application.");
 
-  pg.usage("");
+  pg.usage("[--overlap=<percent>] [--size=<samples>] [--input=<file>]");
+  pg.usage("--input=<file> [--pace=<realtime|fast>] [--bench]");
+  pg.usage("[--analysis=<fft|cqt|sdft|goertzel>] [--size=<samples>]");
+  pg.usage("[--multirate=<1|2|4|8>] [--size=<samples>]");
+  pg.usage("[--zoom] [--size=<samples>]");
+  pg.usage("--input=<-|fifo> [--format=<s16le|f32le>] [--rate=<hz>] [--channels=<1|2>]");
+  pg.usage("--synth=<sweep|tones|impulse|pink|white> [--rate=<hz>] [--channels=<1|2>]");
+  pg.usage("--synth=<sweep|tones|impulse|pink|white> [--duration=<seconds>] [--bench]");
+  pg.usage("--bench-fft");
   pg.usage("[--colour=<on|off|auto>] -h|--help");
   pg.usage("[--colour=<on|off|auto>] -v|--version");
   pg.usage("[--colour=<on|off|auto>] --license");
@@ -120,6 +128,32 @@ inline void program_init(OB::Parg& pg) {
   pg.info({"Examples", {
     {"octavia",
       "run the program"},
+    {"octavia --overlap=50",
+      "run the program, analysing a new window every half window of samples"},
+    {"octavia --analysis=cqt --size=8192",
+      "run the program, showing the same number of bins in each octave"},
+    {"octavia --analysis=sdft",
+      "run the program, updating the bins with every sample as it arrives"},
+    {"octavia --analysis=goertzel",
+      "run the program, measuring each note with a filter tuned to it"},
+    {"octavia --zoom --rate=48000 --synth=tones",
+      "run the program, analysing only the pass band with a smaller fft"},
+    {"octavia --multirate=4",
+      "run the program, resolving the bass with a window four times longer than the rest of the spectrum"},
+    {"octavia --input=song.wav",
+      "run the program, playing the samples of a wav file in place of the recording device"},
+    {"octavia --input=song.wav --pace=fast --size=4096 --bench",
+      "analyse a wav file as fast as possible without a terminal, then print the throughput"},
+    {"parec --raw --format=s16le --rate=48000 --channels=2 | octavia --input=-",
+      "run the program, reading raw samples from another program through stdin, key bindings are unavailable"},
+    {"octavia --input=audio.fifo --format=f32le --rate=44100",
+      "run the program, reading raw float samples from a named pipe"},
+    {"octavia --synth=sweep",
+      "run the program without a recording device, visualizing a repeating sine sweep"},
+    {"octavia --synth=pink --rate=96000 --duration=60 --pace=fast --bench",
+      "analyse a minute of generated pink noise as fast as possible, then print the throughput"},
+    {"octavia --bench-fft",
+      "compare the speed and accuracy of the fft kernels"},
     {"octavia --help --colour=off",
       "print the help output, without colour"},
     {"octavia --help",
@@ -156,6 +190,20 @@ inline void program_init(OB::Parg& pg) {
 
   // options
   pg.set("colour", "auto", "on|off|auto", "Print the program output with colour either on, off, or auto based on if stdout is a tty, the default value is 'auto'.");
+  pg.set("overlap", "75", "percent", "Percentage of each analysis window shared with the next one, from 0 to 95, the default value is '75'.");
+  pg.set("size", "2048", "samples", "Number of samples in each analysis window, an even number no less than 64, the default value is '2048'.");
+  pg.set("analysis", "fft", "fft|cqt|sdft|goertzel", "Turn each analysis window into either linearly spaced fft bins, constant-q bins spaced by the octave scale between the high pass and low pass frequencies, which are resolved as finely as the window size allows, or the same constant-q bins from a sliding dft, updated with every sample as it arrives instead of once a hop, or one bin for each note of the octave scale from a bank of goertzel filters fed with every sample, the default value is 'fft'.");
+  pg.set("multirate", "1", "1|2|4|8", "Decimate the samples by this factor and analyse the bass with a window that many times longer, the same number of samples as the window used above it, giving the bass a finer resolution without delaying the rest of the spectrum, the fft analysis only, the default value is '1'.");
+  pg.set("zoom", "Mix the pass band down to 0 hz and decimate it before the fft, giving the same bins inside the pass band from an fft a power of two smaller, the further the low pass is below the nyquist frequency the smaller the fft, a pass band too wide to halve the sample rate is analysed by the whole fft as without this option, the fft analysis only.");
+  pg.set("input", "", "file", "Read samples from a 16-bit pcm or 32-bit float wav file instead of the recording device, the file is memory mapped and uses its own sample rate. Raw interleaved samples are read from stdin with '-', or from a named pipe.");
+  pg.set("format", "s16le", "s16le|f32le", "Sample format of raw input from stdin or a named pipe, the default value is 's16le'.");
+  pg.set("pace", "realtime", "realtime|fast", "Feed the input samples either at the rate they would be recorded, or as fast as the analysis keeps up, the default value is 'realtime'.");
+  pg.set("synth", "", "sweep|tones|impulse|pink|white", "Generate a test signal instead of using the recording device, either a sine sweep, a chord of sine tones, an impulse twice a second, pink noise, or white noise.");
+  pg.set("rate", "48000", "hz", "Sample rate of the generated signal or raw input, from 8000 to 192000, the default value is '48000'.");
+  pg.set("channels", "2", "1|2", "Number of channels of the generated signal or raw input, the default value is '2'.");
+  pg.set("duration", "0", "seconds", "Length of the generated signal, the default value is '0', which never ends; with --bench the default is '10' and '0' is rejected.");
+  pg.set("bench", "Analyse the whole input without a terminal, then print the number of frames analysed and the time taken.");
+  pg.set("bench-fft", "Compare the fft and decibel kernels against reference transforms, print the time and error of each, then exit with an error if one is over its bound.");
 
   // allow and capture positional arguments
   // pg.set_pos();
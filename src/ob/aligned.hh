@@ -0,0 +1,104 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef OB_ALIGNED_HH
+#define OB_ALIGNED_HH
+
+#include <cstddef>
+
+#include <new>
+#include <limits>
+#include <vector>
+
+namespace OB {
+
+// allocator returning memory aligned to `Align` bytes,
+// 64 by default, a cache line and the widest simd register
+template<typename T, std::size_t Align = 64>
+class aligned_allocator {
+public:
+  using value_type = T;
+
+  static_assert(Align >= alignof(T) && (Align & (Align - 1)) == 0, "alignment must be a power of two");
+
+  template<typename U>
+  struct rebind {
+    using other = aligned_allocator<U, Align>;
+  };
+
+  aligned_allocator() noexcept = default;
+
+  template<typename U>
+  aligned_allocator(aligned_allocator<U, Align> const&) noexcept {
+  }
+
+  T* allocate(std::size_t const size) {
+    if (size > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(::operator new(size * sizeof(T), std::align_val_t {Align}));
+  }
+
+  void deallocate(T* const ptr, std::size_t const) noexcept {
+    ::operator delete(ptr, std::align_val_t {Align});
+  }
+
+  template<typename U>
+  bool operator==(aligned_allocator<U, Align> const&) const noexcept {
+    return true;
+  }
+
+  template<typename U>
+  bool operator!=(aligned_allocator<U, Align> const&) const noexcept {
+    return false;
+  }
+};
+
+template<typename T, std::size_t Align = 64>
+using aligned_vector = std::vector<T, aligned_allocator<T, Align>>;
+
+} // namespace OB
+
+#endif // OB_ALIGNED_HH
@@ -76,15 +76,227 @@ USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef OB_FFT_HH
 #define OB_FFT_HH
 
+#include "ob/thread_pool.hh"
+
 #include <cmath>
 #include <cstddef>
 
+#include <map>
+#include <array>
+#include <mutex>
+#include <tuple>
 #include <complex>
+#include <memory>
 #include <utility>
 #include <vector>
+#include <algorithm>
+
+// lets the compiler vectorize a loop whose stores it can't prove are independent,
+// and keeps the butterflies inlined into those loops in large translation units
+#if defined(__clang__)
+#define OB_FFT_IVDEP _Pragma("clang loop vectorize(assume_safety)")
+#define OB_FFT_INLINE __attribute__((always_inline)) inline
+#elif defined(__GNUC__)
+#define OB_FFT_IVDEP _Pragma("GCC ivdep")
+#define OB_FFT_INLINE __attribute__((always_inline)) inline
+#else
+#define OB_FFT_IVDEP
+#define OB_FFT_INLINE inline
+#endif
 
 namespace OB {
 
+// the kernel used for the complex transform
+enum class FFT_Kernel {
+  // chosen from the transform size
+  automatic,
+  // recursive mixed radix kernel, any size
+  mixed_radix,
+  // iterative radix-4 stockham kernel, power of two sizes
+  stockham,
+  // stockham kernel with compile time tables and loop bounds, sizes 1024 to 16384
+  fixed,
+  // chirp-z convolution through a power of two stockham kernel, any size
+  bluestein,
+  // four-step split into two passes of small stockham transforms spread over a thread pool,
+  // power of two sizes from 2^17
+  four_step,
+};
+
+// stages of the iterative stockham autosort kernel for power of two sizes,
+// shared by the runtime sized and the compile time sized transforms
+// the data is split into real and imaginary arrays and moves between two of them each stage,
+// so no bit reversal pass is needed and every load and store is contiguous or a fixed stride,
+// the butterflies are plain arithmetic with no carried dependency, which the compiler
+// vectorizes for the target instruction set, SSE2 by default and AVX2 with -march
+template<typename Type, bool Inverse>
+struct FFT_Stockham final {
+  using value_type = Type;
+
+  // each radix-4 stage of length `len` has its own contiguous twiddle table,
+  // the real parts then the imaginary parts of w^p, w^2p and w^3p for p < len / 4
+  static constexpr std::size_t twiddles_size(std::size_t const n) {
+    std::size_t size {0};
+    for (std::size_t len = n; len >= 4; len /= 4) {
+      size += 6 * (len / 4);
+    }
+    return size;
+  }
+
+  // radix-4 butterfly of the inputs a, b, c and d into the outputs y0 to y3
+  OB_FFT_INLINE static void bfly4(value_type const* const xr, value_type const* const xi, value_type* const yr, value_type* const yi, std::size_t const a, std::size_t const b, std::size_t const c, std::size_t const d, std::size_t const y0, std::size_t const y1, std::size_t const y2, std::size_t const y3, value_type const* const tw, std::size_t const m, std::size_t const p) {
+    value_type const apcr {xr[a] + xr[c]};
+    value_type const apci {xi[a] + xi[c]};
+    value_type const amcr {xr[a] - xr[c]};
+    value_type const amci {xi[a] - xi[c]};
+    value_type const bpdr {xr[b] + xr[d]};
+    value_type const bpdi {xi[b] + xi[d]};
+    value_type const bmdr {xr[b] - xr[d]};
+    value_type const bmdi {xi[b] - xi[d]};
+    // (b - d) rotated by a quarter turn, -i forward and +i inverse
+    value_type const jr {Inverse ? -bmdi : bmdi};
+    value_type const ji {Inverse ? bmdr : -bmdr};
+
+    yr[y0] = apcr + bpdr;
+    yi[y0] = apci + bpdi;
+    value_type const t1r {amcr + jr};
+    value_type const t1i {amci + ji};
+    yr[y1] = t1r * tw[p] - t1i * tw[m + p];
+    yi[y1] = t1r * tw[m + p] + t1i * tw[p];
+    value_type const t2r {apcr - bpdr};
+    value_type const t2i {apci - bpdi};
+    yr[y2] = t2r * tw[2 * m + p] - t2i * tw[3 * m + p];
+    yi[y2] = t2r * tw[3 * m + p] + t2i * tw[2 * m + p];
+    value_type const t3r {amcr - jr};
+    value_type const t3i {amci - ji};
+    yr[y3] = t3r * tw[4 * m + p] - t3i * tw[5 * m + p];
+    yi[y3] = t3r * tw[5 * m + p] + t3i * tw[4 * m + p];
+  }
+
+  // one radix-4 stage, combines the inputs p, p + m, p + 2m and p + 3m
+  // into the outputs 4p to 4p + 3, each a run of s values
+  OB_FFT_INLINE static void radix4(value_type const* const xr, value_type const* const xi, value_type* const yr, value_type* const yi, value_type const* const tw, std::size_t const m, std::size_t const s) {
+    if (s == 1) {
+      // the first stage runs along p, the outputs are interleaved by 4
+      OB_FFT_IVDEP
+      for (std::size_t p = 0; p < m; ++p) {
+        bfly4(xr, xi, yr, yi, p, p + m, p + 2 * m, p + 3 * m, 4 * p, 4 * p + 1, 4 * p + 2, 4 * p + 3, tw, m, p);
+      }
+      return;
+    }
+
+    // later stages run along the contiguous q with the twiddles fixed
+    for (std::size_t p = 0; p < m; ++p) {
+      std::size_t const a {s * p};
+      std::size_t const y {s * 4 * p};
+      OB_FFT_IVDEP
+      for (std::size_t q = 0; q < s; ++q) {
+        bfly4(xr, xi, yr, yi, a + q, a + s * m + q, a + 2 * s * m + q, a + 3 * s * m + q, y + q, y + s + q, y + 2 * s + q, y + 3 * s + q, tw, m, p);
+      }
+    }
+  }
+
+  // radix-2 stage, all twiddles are 1
+  OB_FFT_INLINE static void radix2(value_type const* const xr, value_type const* const xi, value_type* const yr, value_type* const yi, std::size_t const s) {
+    OB_FFT_IVDEP
+    for (std::size_t q = 0; q < s; ++q) {
+      value_type const ar {xr[q]};
+      value_type const ai {xi[q]};
+      value_type const br {xr[q + s]};
+      value_type const bi {xi[q + s]};
+      yr[q] = ar + br;
+      yi[q] = ai + bi;
+      yr[q + s] = ar - br;
+      yi[q + s] = ai - bi;
+    }
+  }
+}; // struct FFT_Stockham
+
+// stockham kernel for a size known at compile time
+// the twiddle tables are built by the compiler and every loop bound is a constant,
+// so the stages are fully specialized, unrolled and vectorized
+template<typename Type, bool Inverse, std::size_t N>
+class FFT_Fixed final {
+public:
+  using value_type = Type;
+  using stages = FFT_Stockham<Type, Inverse>;
+
+  static_assert(N >= 4 && (N & (N - 1)) == 0, "size must be a power of two");
+
+  /// Transforms the split input held in the first half of @c work,
+  /// @c N real parts followed by @c N imaginary parts, @c work holds @c 4N values.
+  /// Returns the real parts of the output, followed by the imaginary parts.
+  static value_type* transform(value_type* const work) {
+    return stage<N, 1, 0>(work, work + N, work + 2 * N, work + 3 * N);
+  }
+
+private:
+  template<std::size_t Len, std::size_t S, std::size_t Offset>
+  OB_FFT_INLINE static value_type* stage(value_type* const xr, value_type* const xi, value_type* const yr, value_type* const yi) {
+    if constexpr (Len >= 4) {
+      stages::radix4(xr, xi, yr, yi, &_twiddles[Offset], Len / 4, S);
+      return stage<Len / 4, S * 4, Offset + 6 * (Len / 4)>(yr, yi, xr, xi);
+    }
+    else if constexpr (Len == 2) {
+      stages::radix2(xr, xi, yr, yi, S);
+      return yr;
+    }
+    else {
+      return xr;
+    }
+  }
+
+  // sine of the turn k / n for k up to n / 4, evaluable at compile time
+  // summed as a taylor series to double precision
+  static constexpr double sine(std::size_t const k, std::size_t const n) {
+    double const x {2.0 * 3.14159265358979323846 * static_cast<double>(k) / static_cast<double>(n)};
+    double term {x};
+    double sum {x};
+    for (std::size_t i = 2; i < 32; i += 2) {
+      term *= -x * x / static_cast<double>(i * (i + 1));
+      sum += term;
+    }
+    return sum;
+  }
+
+  static constexpr std::array<value_type, stages::twiddles_size(N)> twiddles() {
+    // a quarter wave of sines, the rest of the circle follows by symmetry
+    std::array<double, N / 4 + 1> quarter {};
+    for (std::size_t k = 0; k <= N / 4; ++k) {
+      quarter[k] = sine(k, N);
+    }
+    auto const sin = [&](std::size_t k) {
+      k %= N;
+      if (k <= N / 4) {return quarter[k];}
+      if (k <= N / 2) {return quarter[N / 2 - k];}
+      if (k <= 3 * N / 4) {return -quarter[k - N / 2];}
+      return -quarter[N - k];
+    };
+    auto const cos = [&](std::size_t const k) {
+      return sin(k + N / 4);
+    };
+
+    std::array<value_type, stages::twiddles_size(N)> table {};
+    double const sign {Inverse ? 1.0 : -1.0};
+    std::size_t offset {0};
+    for (std::size_t len = N; len >= 4; len /= 4) {
+      std::size_t const m {len / 4};
+      // w^kp of this stage is w^(kp * N / len) of the whole transform
+      std::size_t const stride {N / len};
+      for (std::size_t p = 0; p < m; ++p) {
+        for (std::size_t k = 1; k < 4; ++k) {
+          table[offset + (2 * k - 2) * m + p] = static_cast<value_type>(cos(k * p * stride));
+          table[offset + (2 * k - 1) * m + p] = static_cast<value_type>(sign * sin(k * p * stride));
+        }
+      }
+      offset += 6 * m;
+    }
+    return table;
+  }
+
+  static constexpr std::array<value_type, stages::twiddles_size(N)> _twiddles {twiddles()};
+}; // class FFT_Fixed
+
 template<typename Type, bool Inverse>
 class FFT_Basic final {
 public:
@@ -104,10 +316,199 @@ public:
     transform(&fft_in[0], &fft_out[0]);
   }
 
+  /// Calculates the DFT of a real input of even size @c N using a
+  /// complex FFT of size @c N/2.
+  ///
+  /// @c fft_out is resized to @c N/2 bins, bin @c N/2 is real and is
+  /// packed into @c fft_out[0].imag(), see the real @c transform() below.
   void operator()(std::vector<value_type> const& fft_in, std::vector<complex_type>& fft_out) {
-    init(fft_in.size());
-    fft_out.resize(fft_in.size());
-    transform(&fft_in[0], &fft_out[0]);
+    fft_out.resize(fft_in.size() / 2);
+    real(&fft_in[0], &fft_out[0], fft_in.size());
+  }
+
+  /// Pointer variant of the real input transform.
+  /// @c fft_in holds @c size values and @c fft_out holds @c size/2 bins.
+  void real(value_type const* const fft_in, complex_type* const fft_out, std::size_t const size) {
+    init(size / 2);
+    transform(fft_in, fft_out);
+  }
+
+  /// Calculates the DFTs of two real inputs of even size @c N with a single
+  /// complex FFT of size @c N, @c a in the real part and @c b in the imaginary part,
+  /// then separates the two spectra using their conjugate symmetry.
+  ///
+  /// @c out_a and @c out_b each hold @c N/2 bins laid out as in @c real(),
+  /// with bin @c N/2 packed into the imaginary part of bin 0.
+  void pair(value_type const* const a, value_type const* const b, complex_type* const out_a, complex_type* const out_b, std::size_t const size) {
+    init(size);
+
+    // A[k] = (Z[k] + conj(Z[N-k])) / 2
+    // B[k] = (Z[k] - conj(Z[N-k])) / 2i
+    auto const separate = [&](value_type const* const zr, value_type const* const zi, std::size_t const stride) {
+      std::size_t const half {size / 2};
+      value_type const h {static_cast<value_type>(0.5)};
+      out_a[0] = complex_type(zr[0], zr[half * stride]);
+      out_b[0] = complex_type(zi[0], zi[half * stride]);
+      for (std::size_t k = 1; k < half; ++k) {
+        std::size_t const i {k * stride};
+        std::size_t const j {(size - k) * stride};
+        out_a[k] = complex_type(h * (zr[i] + zr[j]), h * (zi[i] - zi[j]));
+        out_b[k] = complex_type(h * (zi[i] + zi[j]), h * (zr[j] - zr[i]));
+      }
+    };
+
+    if (_kernel != FFT_Kernel::mixed_radix) {
+      // the inputs already are the split real and imaginary parts the kernel works on
+      std::copy(a, a + size, &_st_work[0]);
+      std::copy(b, b + size, &_st_work[size]);
+      value_type const* const zr {transform_split(&_st_work[0])};
+      separate(zr, zr + size, 1);
+      return;
+    }
+
+    _pairbuf.resize(2 * size);
+    complex_type* const in {&_pairbuf[0]};
+    complex_type* const out {&_pairbuf[size]};
+    for (std::size_t i = 0; i < size; ++i) {
+      in[i] = complex_type(a[i], b[i]);
+    }
+    transform(in, out);
+    // complex values are laid out as an array of their real and imaginary parts
+    value_type const* const z {reinterpret_cast<value_type const*>(out)};
+    separate(z, z + 1, 2);
+  }
+
+  /// Number of values in the caller owned workspace of the in-place
+  /// transforms below, for an input of @c size values.
+  /// Best aligned to 64 bytes, see @c OB::aligned_vector.
+  static constexpr std::size_t workspace(std::size_t const size) {
+    return 4 * size;
+  }
+
+  /// In-place complex transform of @c size values in a caller owned workspace.
+  /// @c work holds the real parts of the input in [0, size)
+  /// and the imaginary parts in [size, 2 * size), the rest is scratch space.
+  ///
+  /// Returns a pointer into @c work to the real parts of the output,
+  /// the imaginary parts follow @c size values later.
+  value_type* split(value_type* const work, std::size_t const size) {
+    init(size);
+    if (_kernel != FFT_Kernel::mixed_radix) {
+      return transform_split(work);
+    }
+
+    // the mixed radix kernel works on interleaved values
+    _pairbuf.resize(2 * size);
+    complex_type* const in {&_pairbuf[0]};
+    complex_type* const out {&_pairbuf[size]};
+    for (std::size_t i = 0; i < size; ++i) {
+      in[i] = complex_type(work[i], work[size + i]);
+    }
+    transform(in, out);
+    for (std::size_t i = 0; i < size; ++i) {
+      work[i] = out[i].real();
+      work[size + i] = out[i].imag();
+    }
+    return work;
+  }
+
+  /// In-place variant of @c real() in a caller owned workspace.
+  /// @c work holds the even samples of the input in [0, size / 2)
+  /// and the odd samples in [size / 2, size), the rest is scratch space.
+  ///
+  /// Returns a pointer into @c work to the real parts of the @c size / 2 bins,
+  /// the imaginary parts follow @c size / 2 values later.
+  /// Bin @c size / 2 is real and is packed into the imaginary part of bin 0.
+  value_type* real_split(value_type* const work, std::size_t const size) {
+    std::size_t const half {size / 2};
+    value_type* const zr {split(work, half)};
+    value_type* const zi {zr + half};
+
+    // the even and odd samples were transformed together as one complex input,
+    // separate them as in pair() and combine them with the twiddles of the full size
+    // X[k] = E[k] + w^k O[k], X[N/2-k] = conj(E[k] - w^k O[k])
+    value_type const h {static_cast<value_type>(0.5)};
+    value_type const z0 {zr[0]};
+    zr[0] = z0 + zi[0];
+    zi[0] = z0 - zi[0];
+    for (std::size_t k = 1; 2 * k <= half; ++k) {
+      std::size_t const j {half - k};
+      value_type const er {h * (zr[k] + zr[j])};
+      value_type const ei {h * (zi[k] - zi[j])};
+      value_type const orr {h * (zi[k] + zi[j])};
+      value_type const oi {h * (zr[j] - zr[k])};
+      value_type const wr {_plan->real_twiddles[k]};
+      value_type const wi {_plan->real_twiddles[half / 2 + 1 + k]};
+      value_type const tr {wr * orr - wi * oi};
+      value_type const ti {wr * oi + wi * orr};
+      zr[k] = er + tr;
+      zi[k] = ei + ti;
+      zr[j] = er - tr;
+      zi[j] = ti - ei;
+    }
+    return zr;
+  }
+
+  /// In-place variant of @c pair() in a caller owned workspace.
+  /// @c work holds the input @c a in [0, size) and @c b in [size, 2 * size),
+  /// the rest is scratch space.
+  ///
+  /// Returns a pointer into @c work to the @c size / 2 bins of each input,
+  /// the real parts of @c a, the imaginary parts of @c a,
+  /// the real parts of @c b, then the imaginary parts of @c b,
+  /// bin @c size / 2 is packed into the imaginary part of bin 0.
+  value_type* pair_split(value_type* const work, std::size_t const size) {
+    value_type const* const zr {split(work, size)};
+    value_type const* const zi {zr + size};
+    // the separated bins go to the half of the workspace the output is not in
+    value_type* const out {zr == work ? work + 2 * size : work};
+    std::size_t const half {size / 2};
+    value_type* const ar {out};
+    value_type* const ai {ar + half};
+    value_type* const br {ai + half};
+    value_type* const bi {br + half};
+
+    // A[k] = (Z[k] + conj(Z[N-k])) / 2
+    // B[k] = (Z[k] - conj(Z[N-k])) / 2i
+    value_type const h {static_cast<value_type>(0.5)};
+    ar[0] = zr[0];
+    ai[0] = zr[half];
+    br[0] = zi[0];
+    bi[0] = zi[half];
+    OB_FFT_IVDEP
+    for (std::size_t k = 1; k < half; ++k) {
+      ar[k] = h * (zr[k] + zr[size - k]);
+      ai[k] = h * (zi[k] - zi[size - k]);
+      br[k] = h * (zi[k] + zi[size - k]);
+      bi[k] = h * (zr[size - k] - zr[k]);
+    }
+    return out;
+  }
+
+  /// Forces the kernel used for the complex transform,
+  /// @c automatic picks the fastest one that supports the size.
+  /// Falls back to the mixed radix kernel if the size is not supported.
+  void kernel(FFT_Kernel const kernel) {
+    _kernel_request = kernel;
+    _nfft = 0;
+  }
+
+  /// The kernel chosen for the current size.
+  FFT_Kernel kernel() const {
+    return _kernel;
+  }
+
+  /// Sets the number of threads of the four-step kernel, the calling thread included,
+  /// 0 picks the number of hardware threads.
+  void threads(std::size_t const threads) {
+    _threads = threads;
+    _pool.reset();
+    _nfft = 0;
+  }
+
+  /// The number of threads of the four-step kernel, 0 until it is used.
+  std::size_t threads() const {
+    return _pool ? _pool->size() : 0;
   }
 
 private:
@@ -115,43 +516,24 @@ private:
     if (_nfft == nfft) {
       return;
     }
+    std::size_t const threads {_threads ? _threads : std::thread::hardware_concurrency()};
+    _plan = plan(nfft, _kernel_request, threads > 1);
     _nfft = nfft;
+    _kernel = _plan->kernel;
 
-    // fill twiddle factors
-    _twiddles.resize(_nfft);
-    if constexpr (Inverse) {
-      value_type const phinc {static_cast<value_type>(2) * std::acos(static_cast<value_type>(-1)) / static_cast<value_type>(_nfft)};
-      for (std::size_t i = 0; i < _nfft; ++i) {
-        _twiddles[i] = std::exp(complex_type(0, i * phinc));
-      }
+    // scratch space of the kernel, the plan is shared and read only
+    if (_kernel != FFT_Kernel::mixed_radix) {
+      _st_work.resize(4 * _nfft);
     }
-    else {
-      value_type const phinc {static_cast<value_type>(-2) * std::acos(static_cast<value_type>(-1)) / static_cast<value_type>(_nfft)};
-      for (std::size_t i = 0; i < _nfft; ++i) {
-        _twiddles[i] = std::exp(complex_type(0, i * phinc));
-      }
-    }
-    _stage_radix.clear();
-    _stage_remainder.clear();
-    std::size_t n {_nfft};
-    std::size_t p {4};
-    do {
-      while (n % p) {
-        switch (p) {
-          case 4: p = 2; break;
-          case 2: p = 3; break;
-          default: p += 2; break;
-        }
-        if (p * p > n) {
-          // no more factors
-          p = n;
-        }
+    if (_kernel == FFT_Kernel::bluestein) {
+      _bs_work.resize(4 * _plan->bs_size);
+    }
+    if (_kernel == FFT_Kernel::four_step) {
+      if (!_pool) {
+        _pool = std::make_shared<thread_pool>(_threads);
       }
-      n /= p;
-      _stage_radix.emplace_back(p);
-      _stage_remainder.emplace_back(n);
+      _fs_work.resize(_pool->size() * 4 * four_step_block * _plan->fs_size[1]);
     }
-    while (n > 1);
   }
 
   /// Calculates the complex Discrete Fourier Transform.
@@ -166,9 +548,18 @@ private:
   /// constructor. Hence when applying the same transform twice, but with
   /// the inverse flag changed the second time, then the result will
   /// be equal to the original input times @c N.
-  void transform(complex_type const* fft_in, complex_type* fft_out, std::size_t const stage = 0, std::size_t const fstride = 1, std::size_t const in_stride = 1) {
-    std::size_t const p {_stage_radix[stage]};
-    std::size_t const m {_stage_remainder[stage]};
+  void transform(complex_type const* fft_in, complex_type* fft_out) {
+    if (_kernel != FFT_Kernel::mixed_radix) {
+      transform_split(fft_in, fft_out);
+    }
+    else {
+      mixed_radix(fft_in, fft_out);
+    }
+  }
+
+  void mixed_radix(complex_type const* fft_in, complex_type* fft_out, std::size_t const stage = 0, std::size_t const fstride = 1, std::size_t const in_stride = 1) {
+    std::size_t const p {_plan->stage_radix[stage]};
+    std::size_t const m {_plan->stage_remainder[stage]};
     complex_type* const fout_beg {fft_out};
     complex_type* const fout_end {fft_out + p * m};
 
@@ -185,7 +576,7 @@ private:
         // DFT of size m*p performed by doing
         // p instances of smaller DFTs of size m,
         // each one takes a decimated version of the input
-        transform(fft_in, fft_out, stage + 1, fstride * p, in_stride);
+        mixed_radix(fft_in, fft_out, stage + 1, fstride * p, in_stride);
         fft_in += fstride * in_stride;
       }
       while ((fft_out += m) != fout_end);
@@ -256,7 +647,7 @@ private:
           dst[k].imag() + dst[_nfft - k].imag(),
           -dst[k].real() + dst[_nfft - k].real());
         const complex_type twiddle = k % 2 == 0 ?
-          _twiddles[k / 2] : _twiddles[k / 2] * twiddle_mul;
+          _plan->twiddles[k / 2] : _plan->twiddles[k / 2] * twiddle_mul;
         dst[k] = w + twiddle * z;
         dst[_nfft - k] = std::conj(w - twiddle * z);
       }
@@ -276,7 +667,7 @@ private:
           dst[k].imag() + dst[_nfft - k].imag(),
           -dst[k].real() + dst[_nfft - k].real());
         const complex_type twiddle = k % 2 == 0 ?
-          _twiddles[k / 2] : _twiddles[k / 2] * twiddle_mul;
+          _plan->twiddles[k / 2] : _plan->twiddles[k / 2] * twiddle_mul;
         dst[k] = w + twiddle * z;
         dst[_nfft - k] = std::conj(w - twiddle * z);
       }
@@ -288,7 +679,7 @@ private:
 
   void kf_bfly2(complex_type* fout, std::size_t const fstride, std::size_t const m) const {
     for (std::size_t k = 0; k < m; ++k) {
-      complex_type const t {fout[m + k] * _twiddles[k * fstride]};
+      complex_type const t {fout[m + k] * _plan->twiddles[k * fstride]};
       fout[m + k] = fout[k] - t;
       fout[k] += t;
     }
@@ -297,9 +688,9 @@ private:
   void kf_bfly3(complex_type* fout, std::size_t const fstride, std::size_t const m) const {
     std::size_t k {m};
     std::size_t const m2 {2 * m};
-    complex_type const* tw1 {&_twiddles[0]};
-    complex_type const* tw2 {&_twiddles[0]};
-    complex_type const epi3 {_twiddles[fstride * m]};
+    complex_type const* tw1 {&_plan->twiddles[0]};
+    complex_type const* tw2 {&_plan->twiddles[0]};
+    complex_type const epi3 {_plan->twiddles[fstride * m]};
     complex_type scratch[5];
 
     do{
@@ -329,9 +720,9 @@ private:
 
     if constexpr (Inverse) {
       for (std::size_t k = 0; k < m; ++k) {
-        scratch[0] = fout[k + m] * _twiddles[k * fstride];
-        scratch[1] = fout[k + 2 * m] * _twiddles[k * fstride * 2];
-        scratch[2] = fout[k + 3 * m] * _twiddles[k * fstride * 3];
+        scratch[0] = fout[k + m] * _plan->twiddles[k * fstride];
+        scratch[1] = fout[k + 2 * m] * _plan->twiddles[k * fstride * 2];
+        scratch[2] = fout[k + 3 * m] * _plan->twiddles[k * fstride * 3];
         scratch[5] = fout[k] - scratch[1];
 
         fout[k] += scratch[1];
@@ -348,9 +739,9 @@ private:
     }
     else {
       for (std::size_t k = 0; k < m; ++k) {
-        scratch[0] = fout[k + m] * _twiddles[k * fstride];
-        scratch[1] = fout[k + 2 * m] * _twiddles[k * fstride * 2];
-        scratch[2] = fout[k + 3 * m] * _twiddles[k * fstride * 3];
+        scratch[0] = fout[k + m] * _plan->twiddles[k * fstride];
+        scratch[1] = fout[k + 2 * m] * _plan->twiddles[k * fstride * 2];
+        scratch[2] = fout[k + 3 * m] * _plan->twiddles[k * fstride * 3];
         scratch[5] = fout[k] - scratch[1];
 
         fout[k] += scratch[1];
@@ -369,20 +760,20 @@ private:
   void kf_bfly5(complex_type* const fout, std::size_t const fstride, std::size_t const m) const {
     complex_type* fout0 {fout};
     complex_type* fout1 {fout0 + m};
-    complex_type* fout2 {fout0 + m + 2};
-    complex_type* fout3 {fout0 + m + 3};
-    complex_type* fout4 {fout0 + m + 4};
+    complex_type* fout2 {fout0 + 2 * m};
+    complex_type* fout3 {fout0 + 3 * m};
+    complex_type* fout4 {fout0 + 4 * m};
     complex_type scratch[13];
-    complex_type const ya {_twiddles[fstride * m]};
-    complex_type const yb {_twiddles[fstride * 2 * m]};
+    complex_type const ya {_plan->twiddles[fstride * m]};
+    complex_type const yb {_plan->twiddles[fstride * 2 * m]};
 
     for (std::size_t u = 0; u < m; ++u) {
       scratch[0] = *fout0;
 
-      scratch[1] = *fout1 * _twiddles[u * fstride];
-      scratch[2] = *fout2 * _twiddles[2 * u * fstride];
-      scratch[3] = *fout3 * _twiddles[3 * u * fstride];
-      scratch[4] = *fout4 * _twiddles[4 * u * fstride];
+      scratch[1] = *fout1 * _plan->twiddles[u * fstride];
+      scratch[2] = *fout2 * _plan->twiddles[2 * u * fstride];
+      scratch[3] = *fout3 * _plan->twiddles[3 * u * fstride];
+      scratch[4] = *fout4 * _plan->twiddles[4 * u * fstride];
 
       scratch[7] = scratch[1] + scratch[4];
       scratch[10] = scratch[1] - scratch[4];
@@ -424,7 +815,7 @@ private:
 
   // perform the butterfly for one stage of a mixed radix FFT
   void kf_bfly_generic(complex_type* const fout, std::size_t const fstride, std::size_t const m, std::size_t const p) {
-    complex_type const* twiddles {&_twiddles[0]};
+    complex_type const* twiddles {&_plan->twiddles[0]};
 
     if (p > _scratchbuf.size()) {
       _scratchbuf.resize(p);
@@ -453,10 +844,449 @@ private:
     }
   }
 
+  // sizes with a compile time sized kernel
+  static constexpr bool fixed(std::size_t const nfft) {
+    return nfft >= 1024 && nfft <= 16384 && (nfft & (nfft - 1)) == 0;
+  }
+
+  // sizes transformed faster as a convolution than by the mixed radix kernel,
+  // from the cost of its stages against three transforms of the padded size,
+  // the weights were measured against the stockham kernel
+  static bool bluestein(std::size_t const nfft, std::vector<std::size_t> const& radix) {
+    double mixed {0};
+    for (auto const p : radix) {
+      // the generic butterfly does p complex multiply-adds per output
+      mixed += p <= 5 ? 8.0 : 10.0 * static_cast<double>(p);
+    }
+    mixed *= static_cast<double>(nfft);
+    std::size_t const size {bluestein_size(nfft)};
+    double const convolution {3.0 * static_cast<double>(size) * std::log2(static_cast<double>(size))};
+    return convolution < mixed;
+  }
+
+  // power of two size of the convolution, long enough not to wrap around
+  static std::size_t bluestein_size(std::size_t const nfft) {
+    std::size_t size {4};
+    while (size < 2 * nfft - 1) {
+      size *= 2;
+    }
+    return size;
+  }
+
+  // per stage twiddle tables in the layout of FFT_Stockham for a power of two size `n`
+  static void stockham_twiddles(std::vector<value_type>& twiddles, std::size_t const n) {
+    double const sign {Inverse ? 1.0 : -1.0};
+    twiddles.clear();
+    for (std::size_t len = n; len >= 4; len /= 4) {
+      std::size_t const m {len / 4};
+      std::size_t const offset {twiddles.size()};
+      twiddles.resize(offset + 6 * m);
+      value_type* const tw {&twiddles[offset]};
+      for (std::size_t p = 0; p < m; ++p) {
+        for (std::size_t k = 1; k < 4; ++k) {
+          double const phi {sign * 2.0 * M_PI * static_cast<double>(k * p) / static_cast<double>(len)};
+          tw[(2 * k - 2) * m + p] = static_cast<value_type>(std::cos(phi));
+          tw[(2 * k - 1) * m + p] = static_cast<value_type>(std::sin(phi));
+        }
+      }
+    }
+  }
+
+  // transforms the split input held in the first half of `work`, 4n values,
+  // the output is written back to the first half
+  value_type* bluestein_split(value_type* const work) {
+    std::size_t const n {_nfft};
+    std::size_t const m {_plan->bs_size};
+    value_type const* const wr {&_plan->bs_chirp[0]};
+    value_type const* const wi {wr + n};
+    value_type* const xr {&_bs_work[0]};
+    value_type* const xi {xr + m};
+
+    // multiply by the chirp and pad with zeros
+    for (std::size_t k = 0; k < n; ++k) {
+      value_type const ar {work[k]};
+      value_type const ai {work[n + k]};
+      xr[k] = ar * wr[k] - ai * wi[k];
+      xi[k] = ar * wi[k] + ai * wr[k];
+    }
+    std::fill(xr + n, xr + m, value_type(0));
+    std::fill(xi + n, xi + m, value_type(0));
+
+    // multiply by the filter, conjugated so the same transform runs the convolution backwards
+    value_type* zr {pow2_split(xr, m, _plan->st_twiddles.data(), true)};
+    value_type* zi {zr + m};
+    value_type const* const fr {&_plan->bs_filter[0]};
+    value_type const* const fi {fr + m};
+    OB_FFT_IVDEP
+    for (std::size_t k = 0; k < m; ++k) {
+      value_type const ar {zr[k]};
+      value_type const ai {zi[k]};
+      zr[k] = ar * fr[k] - ai * fi[k];
+      zi[k] = -(ar * fi[k] + ai * fr[k]);
+    }
+    // the transform of the other half lands back in the first half of the workspace
+    if (zr != xr) {
+      std::copy(zr, zr + 2 * m, xr);
+    }
+    zr = pow2_split(xr, m, _plan->st_twiddles.data(), true);
+    zi = zr + m;
+
+    // conjugate back and multiply by the chirp
+    for (std::size_t k = 0; k < n; ++k) {
+      value_type const ar {zr[k]};
+      value_type const ai {-zi[k]};
+      work[k] = ar * wr[k] - ai * wi[k];
+      work[n + k] = ar * wi[k] + ai * wr[k];
+    }
+    return work;
+  }
+
+  // sizes from which the working set of the stockham kernel spills out of the l2 cache
+  static constexpr std::size_t four_step_size {std::size_t {1} << 17};
+  // columns transformed at once, a cache line of values
+  static constexpr std::size_t four_step_block {16};
+
+  // transforms the split input held in the first half of `work`, 4n values,
+  // the intermediate result goes to the second half, the output to the first half
+  value_type* four_step_split(value_type* const work) {
+    constexpr std::size_t block {four_step_block};
+    std::size_t const n {_nfft};
+    std::size_t const n1 {_plan->fs_size[0]};
+    std::size_t const n2 {_plan->fs_size[1]};
+    value_type* const xr {work};
+    value_type* const xi {xr + n};
+    value_type* const yr {xi + n};
+    value_type* const yi {yr + n};
+
+    // a block of columns is copied out a row at a time and transformed together,
+    // value r of column c at r * block + c
+    auto const columns = [&](value_type const* const ar, value_type const* const ai, std::size_t const rows, std::size_t const width,
+      std::size_t const col, std::size_t const thread, value_type const* const tw) {
+      value_type* const scratch {&_fs_work[thread * 4 * block * n2]};
+      value_type* const br {scratch};
+      value_type* const bi {scratch + rows * block};
+      for (std::size_t r = 0; r < rows; ++r) {
+        std::copy(ar + r * width + col, ar + r * width + col + block, br + r * block);
+        std::copy(ai + r * width + col, ai + r * width + col + block, bi + r * block);
+      }
+      return pow2_batch(scratch, rows, block, tw);
+    };
+
+    // columns j2 of the input, twiddled and stored as rows of the intermediate result
+    _pool->run(n2 / block, [&](std::size_t const task, std::size_t const thread) {
+      std::size_t const col {task * block};
+      value_type* const zr {columns(xr, xi, n1, n2, col, thread, _plan->fs_twiddles[0].data())};
+      value_type* const zi {zr + n1 * block};
+      // transposed a square tile of a block at a time
+      for (std::size_t k1 = 0; k1 < n1; k1 += block) {
+        for (std::size_t c = 0; c < block; ++c) {
+          std::size_t const y {(col + c) * n1 + k1};
+          value_type const* const wr {&_plan->fs_rotate[y]};
+          value_type const* const wi {wr + n};
+          for (std::size_t k = 0; k < block; ++k) {
+            value_type const ar {zr[(k1 + k) * block + c]};
+            value_type const ai {zi[(k1 + k) * block + c]};
+            yr[y + k] = ar * wr[k] - ai * wi[k];
+            yi[y + k] = ar * wi[k] + ai * wr[k];
+          }
+        }
+      }
+    });
+
+    // columns k1 of the intermediate result, stored as columns of the output
+    _pool->run(n1 / block, [&](std::size_t const task, std::size_t const thread) {
+      std::size_t const col {task * block};
+      value_type const* const zr {columns(yr, yi, n2, n1, col, thread, _plan->fs_twiddles[1].data())};
+      value_type const* const zi {zr + n2 * block};
+      for (std::size_t k2 = 0; k2 < n2; ++k2) {
+        std::copy(zr + k2 * block, zr + k2 * block + block, xr + k2 * n1 + col);
+        std::copy(zi + k2 * block, zi + k2 * block + block, xi + k2 * n1 + col);
+      }
+    });
+
+    return xr;
+  }
+
+  // stockham kernel for `batch` interleaved transforms of a power of two size `n`,
+  // value i of transform c at i * batch + c, the same stages with every stride `batch` times larger,
+  // so the innermost loops run over the transforms
+  static value_type* pow2_batch(value_type* const work, std::size_t const n, std::size_t const batch, value_type const* tw) {
+    using stages = FFT_Stockham<Type, Inverse>;
+    std::size_t const size {n * batch};
+    value_type* xr {work};
+    value_type* xi {xr + size};
+    value_type* yr {xi + size};
+    value_type* yi {yr + size};
+
+    std::size_t s {batch};
+    for (std::size_t len = n; len >= 4; len /= 4) {
+      std::size_t const m {len / 4};
+      stages::radix4(xr, xi, yr, yi, tw, m, s);
+      tw += 6 * m;
+      std::swap(xr, yr);
+      std::swap(xi, yi);
+      s *= 4;
+    }
+
+    if (s < size) {
+      stages::radix2(xr, xi, yr, yi, s);
+      std::swap(xr, yr);
+    }
+
+    return xr;
+  }
+
+  // kernels working on split values, for interleaved complex values
+  void transform_split(complex_type const* const fft_in, complex_type* const fft_out) {
+    std::size_t const n {_nfft};
+    value_type* const xr {&_st_work[0]};
+    value_type* const xi {xr + n};
+    for (std::size_t i = 0; i < n; ++i) {
+      xr[i] = fft_in[i].real();
+      xi[i] = fft_in[i].imag();
+    }
+
+    value_type const* const zr {transform_split(&_st_work[0])};
+    value_type const* const zi {zr + n};
+    for (std::size_t i = 0; i < n; ++i) {
+      fft_out[i] = complex_type(zr[i], zi[i]);
+    }
+  }
+
+  // transforms the split input held in the first two quarters of `work`, 4n values,
+  // returns the real parts of the output, followed by the imaginary parts
+  value_type* transform_split(value_type* const work) {
+    if (_kernel == FFT_Kernel::bluestein) {
+      return bluestein_split(work);
+    }
+    if (_kernel == FFT_Kernel::four_step) {
+      return four_step_split(work);
+    }
+    return pow2_split(work, _nfft, _plan->st_twiddles.data(), _kernel == FFT_Kernel::fixed);
+  }
+
+  // stockham kernel for a power of two size `n`, the compile time sized one if `fixed` and there is one
+  static value_type* pow2_split(value_type* const work, std::size_t const n, value_type const* tw, bool const fixed) {
+    if (fixed) {
+      switch (n) {
+        case 1024: return FFT_Fixed<Type, Inverse, 1024>::transform(work);
+        case 2048: return FFT_Fixed<Type, Inverse, 2048>::transform(work);
+        case 4096: return FFT_Fixed<Type, Inverse, 4096>::transform(work);
+        case 8192: return FFT_Fixed<Type, Inverse, 8192>::transform(work);
+        case 16384: return FFT_Fixed<Type, Inverse, 16384>::transform(work);
+        default: break;
+      }
+    }
+
+    using stages = FFT_Stockham<Type, Inverse>;
+    value_type* xr {work};
+    value_type* xi {xr + n};
+    value_type* yr {xi + n};
+    value_type* yi {yr + n};
+
+    std::size_t s {1};
+    for (std::size_t len = n; len >= 4; len /= 4) {
+      std::size_t const m {len / 4};
+      stages::radix4(xr, xi, yr, yi, tw, m, s);
+      tw += 6 * m;
+      std::swap(xr, yr);
+      std::swap(xi, yi);
+      s *= 4;
+    }
+
+    if (s < n) {
+      stages::radix2(xr, xi, yr, yi, s);
+      std::swap(xr, yr);
+    }
+
+    return xr;
+  }
+
+  // the tables of a transform size, immutable once built and shared through plan()
+  struct Plan {
+    Plan(std::size_t const size, FFT_Kernel const request, bool const parallel) :
+      nfft {size} {
+      // w^k of a real transform of twice the size, for k up to a quarter turn,
+      // the cosines then the sines
+      double const sign {Inverse ? 1.0 : -1.0};
+      std::size_t const quarter {nfft / 2 + 1};
+      real_twiddles.resize(2 * quarter);
+      for (std::size_t k = 0; k < quarter; ++k) {
+        double const phi {sign * M_PI * static_cast<double>(k) / static_cast<double>(nfft)};
+        real_twiddles[k] = static_cast<value_type>(std::cos(phi));
+        real_twiddles[quarter + k] = static_cast<value_type>(std::sin(phi));
+      }
+
+      bool const pow2 {nfft >= 4 && (nfft & (nfft - 1)) == 0};
+      kernel = FFT_Kernel::mixed_radix;
+      if (pow2 && request != FFT_Kernel::mixed_radix) {
+        kernel = request != FFT_Kernel::stockham && fixed(nfft) ? FFT_Kernel::fixed : FFT_Kernel::stockham;
+        stockham_init();
+        // on a single thread it only about matches the stockham kernel
+        if ((request == FFT_Kernel::four_step && nfft >= four_step_block * four_step_block) || (request == FFT_Kernel::automatic && nfft >= four_step_size && parallel)) {
+          kernel = FFT_Kernel::four_step;
+          four_step_init();
+        }
+      }
+
+      // fill twiddle factors
+      twiddles.resize(nfft);
+      if constexpr (Inverse) {
+        value_type const phinc {static_cast<value_type>(2) * std::acos(static_cast<value_type>(-1)) / static_cast<value_type>(nfft)};
+        for (std::size_t i = 0; i < nfft; ++i) {
+          twiddles[i] = std::exp(complex_type(0, i * phinc));
+        }
+      }
+      else {
+        value_type const phinc {static_cast<value_type>(-2) * std::acos(static_cast<value_type>(-1)) / static_cast<value_type>(nfft)};
+        for (std::size_t i = 0; i < nfft; ++i) {
+          twiddles[i] = std::exp(complex_type(0, i * phinc));
+        }
+      }
+      std::size_t n {nfft};
+      std::size_t p {4};
+      do {
+        while (n % p) {
+          switch (p) {
+            case 4: p = 2; break;
+            case 2: p = 3; break;
+            default: p += 2; break;
+          }
+          if (p * p > n) {
+            // no more factors
+            p = n;
+          }
+        }
+        n /= p;
+        stage_radix.emplace_back(p);
+        stage_remainder.emplace_back(n);
+      }
+      while (n > 1);
+
+      // the generic butterfly is O(p^2) for each prime factor p without its own butterfly,
+      // a size with a large one is transformed as a convolution of a power of two size instead
+      if (!pow2 && nfft > 1 && (request == FFT_Kernel::bluestein || (request == FFT_Kernel::automatic && bluestein(nfft, stage_radix)))) {
+        kernel = FFT_Kernel::bluestein;
+        bluestein_init();
+      }
+    }
+
+    // the compile time sized kernels carry their own twiddle tables
+    void stockham_init() {
+      if (kernel == FFT_Kernel::fixed) {
+        return;
+      }
+      stockham_twiddles(st_twiddles, nfft);
+    }
+
+    // X[k] = w[k] sum_j (x[j] w[j]) conj(w[k - j]) with the chirp w[k] = e^(-i pi k^2 / n),
+    // the sum is a circular convolution of a power of two size m >= 2n - 1,
+    // computed by transforming both sides, multiplying, and transforming back
+    void bluestein_init() {
+      std::size_t const n {nfft};
+      std::size_t const m {bluestein_size(n)};
+      double const sign {Inverse ? 1.0 : -1.0};
+      bs_size = m;
+      stockham_twiddles(st_twiddles, m);
+
+      // k^2 is taken modulo 2n so the phase stays exact for large k
+      bs_chirp.resize(2 * n);
+      for (std::size_t k = 0; k < n; ++k) {
+        double const phi {sign * M_PI * static_cast<double>((k * k) % (2 * n)) / static_cast<double>(n)};
+        bs_chirp[k] = static_cast<value_type>(std::cos(phi));
+        bs_chirp[n + k] = static_cast<value_type>(std::sin(phi));
+      }
+
+      // transform of the conjugate chirp wrapped around the convolution,
+      // scaled by 1 / m for the transform back
+      std::vector<value_type> work (4 * m, 0);
+      value_type* const br {&work[0]};
+      value_type* const bi {br + m};
+      for (std::size_t k = 0; k < n; ++k) {
+        br[k] = bs_chirp[k];
+        bi[k] = -bs_chirp[n + k];
+        if (k > 0) {
+          br[m - k] = br[k];
+          bi[m - k] = bi[k];
+        }
+      }
+      value_type const* const zr {pow2_split(&work[0], m, st_twiddles.data(), true)};
+      value_type const scale {static_cast<value_type>(1.0 / static_cast<double>(m))};
+      bs_filter.resize(2 * m);
+      for (std::size_t k = 0; k < 2 * m; ++k) {
+        bs_filter[k] = zr[k] * scale;
+      }
+    }
+
+    // n = n1 n2 with the input as n1 rows of n2 and the output as n2 rows of n1,
+    // X[k1 + n1 k2] = sum_j2 W_n2^(j2 k2) W_n^(j2 k1) sum_j1 W_n1^(j1 k1) x[j1 n2 + j2],
+    // transformed by the columns of the input, then by the columns of the twiddled result
+    void four_step_init() {
+      std::size_t const n {nfft};
+      std::size_t n1 {1};
+      while (n1 * n1 < n) {
+        n1 *= 2;
+      }
+      if (n1 * n1 > n) {
+        n1 /= 2;
+      }
+      std::size_t const n2 {n / n1};
+      fs_size = {n1, n2};
+      stockham_twiddles(fs_twiddles[0], n1);
+      stockham_twiddles(fs_twiddles[1], n2);
+
+      // W_n^(j2 k1) in the layout of the intermediate result, the real parts then the imaginary parts
+      double const sign {Inverse ? 1.0 : -1.0};
+      fs_rotate.resize(2 * n);
+      for (std::size_t j2 = 0; j2 < n2; ++j2) {
+        for (std::size_t k1 = 0; k1 < n1; ++k1) {
+          double const phi {sign * 2.0 * M_PI * static_cast<double>(j2 * k1) / static_cast<double>(n)};
+          fs_rotate[j2 * n1 + k1] = static_cast<value_type>(std::cos(phi));
+          fs_rotate[n + j2 * n1 + k1] = static_cast<value_type>(std::sin(phi));
+        }
+      }
+    }
+
+    std::size_t nfft {0};
+    FFT_Kernel kernel {FFT_Kernel::mixed_radix};
+    std::vector<value_type> real_twiddles;
+    std::vector<complex_type> twiddles;
+    std::vector<std::size_t> stage_radix;
+    std::vector<std::size_t> stage_remainder;
+    std::vector<value_type> st_twiddles;
+    std::size_t bs_size {0};
+    std::vector<value_type> bs_chirp;
+    std::vector<value_type> bs_filter;
+    std::array<std::size_t, 2> fs_size {};
+    std::array<std::vector<value_type>, 2> fs_twiddles;
+    std::vector<value_type> fs_rotate;
+  }; // struct Plan
+
+  // plans are keyed by size, kernel request and whether the four-step kernel may be picked,
+  // the direction and precision are those of this class,
+  // each is built once and kept for the life of the process, so switching sizes is a lookup
+  static std::shared_ptr<Plan const> plan(std::size_t const nfft, FFT_Kernel const request, bool const parallel) {
+    static std::mutex mutex;
+    static std::map<std::tuple<std::size_t, FFT_Kernel, bool>, std::shared_ptr<Plan const>> plans;
+    std::lock_guard<std::mutex> lock {mutex};
+    auto& entry = plans[{nfft, request, parallel}];
+    if (!entry) {
+      entry = std::make_shared<Plan const>(nfft, request, parallel);
+    }
+    return entry;
+  }
+
   std::size_t _nfft {0};
-  std::vector<complex_type> _twiddles;
-  std::vector<std::size_t> _stage_radix;
-  std::vector<std::size_t> _stage_remainder;
+  FFT_Kernel _kernel_request {FFT_Kernel::automatic};
+  FFT_Kernel _kernel {FFT_Kernel::mixed_radix};
+  std::shared_ptr<Plan const> _plan;
+  std::vector<value_type> _st_work;
+  std::vector<value_type> _bs_work;
+  std::vector<value_type> _fs_work;
+  std::size_t _threads {0};
+  // shared by copies, the calls of each copy take turns
+  std::shared_ptr<thread_pool> _pool;
+  std::vector<complex_type> _pairbuf;
   std::vector<complex_type> _scratchbuf;
 }; // class FFT_Basic
 
@@ -46,7 +46,12 @@ SOFTWARE.
 #ifndef OB_RING_HH
 #define OB_RING_HH
 
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
 #include <vector>
+#include <algorithm>
 #include <initializer_list>
 
 namespace OB {
@@ -121,6 +126,104 @@ private:
 template<typename T>
 using ring_vector = basic_ring<std::vector<T>>;
 
+// wait-free single-producer/single-consumer ring
+// the producer never waits on the consumer, once the ring is full it
+// overwrites the oldest values
+// the consumer reads any window of values ending at a published position,
+// and is told afterwards if the producer overwrote part of it while reading
+template<typename T>
+class spsc_ring {
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using position_type = std::uint64_t;
+
+  spsc_ring() = default;
+
+  explicit spsc_ring(size_type const size) {
+    resize(size);
+  }
+
+  spsc_ring(spsc_ring const&) = delete;
+
+  spsc_ring& operator=(spsc_ring const&) = delete;
+
+  // capacity is rounded up to a power of two
+  // not thread safe, the producer and consumer must be idle
+  void resize(size_type const size) {
+    size_type capacity {1};
+    while (capacity < size) {capacity <<= 1;}
+    _buffer.assign(capacity, value_type());
+    _mask = capacity - 1;
+    _head.store(0, std::memory_order_relaxed);
+    _reserve.store(0, std::memory_order_relaxed);
+  }
+
+  // not thread safe, the producer and consumer must be idle
+  void clear() {
+    std::fill(_buffer.begin(), _buffer.end(), value_type());
+    _head.store(0, std::memory_order_relaxed);
+    _reserve.store(0, std::memory_order_relaxed);
+  }
+
+  size_type capacity() const noexcept {
+    return _buffer.size();
+  }
+
+  // total number of values published by the producer
+  position_type head() const noexcept {
+    return _head.load(std::memory_order_acquire);
+  }
+
+  // producer only
+  void push(value_type const* data, size_type size) {
+    auto head = _head.load(std::memory_order_relaxed);
+    if (size > capacity()) {
+      data += size - capacity();
+      head += size - capacity();
+      size = capacity();
+    }
+
+    // announce the range about to be overwritten before touching it
+    _reserve.store(head + size, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    auto const pos = static_cast<size_type>(head & _mask);
+    auto const count = std::min(size, capacity() - pos);
+    std::copy(data, data + count, &_buffer[pos]);
+    std::copy(data + count, data + size, &_buffer[0]);
+
+    _head.store(head + size, std::memory_order_release);
+  }
+
+  // consumer only
+  // calls `fn(ptr, count)` for each contiguous part of the `size` values
+  // ending at position `end`, which must not be past `head()`
+  // values before position 0 read as value_type()
+  // returns false if the producer overwrote part of the range while it was
+  // being read, in which case the values passed to `fn` are unreliable
+  template<typename F>
+  bool read(position_type const end, size_type const size, F&& fn) const {
+    if (size > capacity()) {return false;}
+
+    auto const pos = static_cast<size_type>((end - size) & _mask);
+    auto const count = std::min(size, capacity() - pos);
+    fn(&_buffer[pos], count);
+    if (count < size) {
+      fn(&_buffer[0], size - count);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return _reserve.load(std::memory_order_relaxed) <= end - size + capacity();
+  }
+
+private:
+  std::vector<value_type> _buffer;
+  size_type _mask {0};
+  std::atomic<position_type> _head {0};
+  std::atomic<position_type> _reserve {0};
+}; // class spsc_ring
+
 } // namespace OB
 
 #endif // OB_RING_HH
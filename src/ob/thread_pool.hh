@@ -0,0 +1,179 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef OB_THREAD_POOL_HH
+#define OB_THREAD_POOL_HH
+
+#include <cstddef>
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <condition_variable>
+
+namespace OB {
+
+// fork-join pool of worker threads
+// run() spreads the tasks of one job over the workers and the calling thread,
+// then returns once every task is done, calls from more than one thread take turns
+class thread_pool {
+public:
+  // `threads` counts the calling thread, 0 picks the number of hardware threads
+  explicit thread_pool(std::size_t threads = 0) {
+    if (threads == 0) {
+      threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    _workers.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i) {
+      _workers.emplace_back([this, i]() {worker(i);});
+    }
+  }
+
+  thread_pool(thread_pool const&) = delete;
+
+  thread_pool& operator=(thread_pool const&) = delete;
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock {_mutex};
+      _stop = true;
+    }
+    _job_cv.notify_all();
+    for (auto& e : _workers) {
+      e.join();
+    }
+  }
+
+  // number of threads working on a job, the calling thread included
+  std::size_t size() const noexcept {
+    return _workers.size() + 1;
+  }
+
+  // calls fn(task, thread) once for each task in [0, tasks),
+  // `thread` is in [0, size()) and no two calls running at once share it
+  template<typename F>
+  void run(std::size_t const tasks, F&& fn) {
+    if (tasks == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> turn {_turn};
+    if (_workers.empty() || tasks == 1) {
+      for (std::size_t i = 0; i < tasks; ++i) {
+        fn(i, std::size_t {0});
+      }
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock {_mutex};
+      _job = Job {&fn, [](void* ctx, std::size_t const task, std::size_t const thread) {
+        (*static_cast<std::remove_reference_t<F>*>(ctx))(task, thread);
+      }, tasks};
+      _next.store(0, std::memory_order_relaxed);
+      ++_generation;
+    }
+    _job_cv.notify_all();
+
+    work(_job, 0);
+
+    // wait for the workers still running a task of this job
+    std::unique_lock<std::mutex> lock {_mutex};
+    _done_cv.wait(lock, [&] {return _active == 0;});
+    _job = Job {};
+  }
+
+private:
+  struct Job {
+    void* ctx {nullptr};
+    void (*call)(void*, std::size_t, std::size_t) {nullptr};
+    std::size_t tasks {0};
+  };
+
+  void work(Job const& job, std::size_t const thread) {
+    for (std::size_t task = _next.fetch_add(1, std::memory_order_relaxed); task < job.tasks; task = _next.fetch_add(1, std::memory_order_relaxed)) {
+      job.call(job.ctx, task, thread);
+    }
+  }
+
+  void worker(std::size_t const thread) {
+    std::size_t generation {0};
+    std::unique_lock<std::mutex> lock {_mutex};
+    for (;;) {
+      _job_cv.wait(lock, [&] {return _stop || (_generation != generation && _job.call);});
+      if (_stop) {
+        return;
+      }
+      generation = _generation;
+      Job const job {_job};
+      ++_active;
+      lock.unlock();
+
+      work(job, thread);
+
+      lock.lock();
+      if (--_active == 0) {
+        _done_cv.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> _workers;
+  std::mutex _turn;
+  std::mutex _mutex;
+  std::condition_variable _job_cv;
+  std::condition_variable _done_cv;
+  Job _job;
+  std::atomic<std::size_t> _next {0};
+  std::size_t _generation {0};
+  std::size_t _active {0};
+  bool _stop {false};
+}; // class thread_pool
+
+} // namespace OB
+
+#endif // OB_THREAD_POOL_HH
@@ -0,0 +1,123 @@
+/*
+                                    88888888
+                                  888888888888
+                                 88888888888888
+                                8888888888888888
+                               888888888888888888
+                              888888  8888  888888
+                              88888    88    88888
+                              888888  8888  888888
+                              88888888888888888888
+                              88888888888888888888
+                             8888888888888888888888
+                          8888888888888888888888888888
+                        88888888888888888888888888888888
+                              88888888888888888888
+                            888888888888888888888888
+                           888888  8888888888  888888
+                           888     8888  8888     888
+                                   888    888
+
+                                   OCTOBANANA
+
+Licensed under the MIT License
+
+Copyright (c) 2020 Brett Robinson <https://octobanana.com/>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef OB_TRIPLE_BUFFER_HH
+#define OB_TRIPLE_BUFFER_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+
+namespace OB {
+
+// wait-free single-producer/single-consumer triple buffer
+// the producer fills the back value and publishes it,
+// the consumer takes the most recently published value,
+// neither side waits on or copies from the other, values are exchanged by index
+template<typename T>
+class triple_buffer {
+public:
+  using value_type = T;
+
+  triple_buffer() = default;
+
+  triple_buffer(triple_buffer const&) = delete;
+
+  triple_buffer& operator=(triple_buffer const&) = delete;
+
+  // not thread safe, the producer and consumer must be idle
+  template<typename F>
+  void for_each(F&& fn) {
+    for (auto& e : _buffer) {fn(e);}
+  }
+
+  // producer only
+  // the value to fill before the next publish
+  value_type& back() noexcept {
+    return _buffer[_back];
+  }
+
+  // producer only
+  // hand the back value to the consumer, the previous middle value becomes the new back
+  void publish() noexcept {
+    _back = _middle.exchange(static_cast<std::uint8_t>(_back | fresh), std::memory_order_acq_rel) & index;
+  }
+
+  // producer only
+  // true when the consumer has taken the last published value
+  bool consumed() const noexcept {
+    return !(_middle.load(std::memory_order_acquire) & fresh);
+  }
+
+  // consumer only
+  // take the last published value if there is a new one
+  // returns true if the front value changed
+  bool update() noexcept {
+    if (!(_middle.load(std::memory_order_relaxed) & fresh)) {return false;}
+    _front = _middle.exchange(_front, std::memory_order_acq_rel) & index;
+    return true;
+  }
+
+  // consumer only
+  // stays valid and unchanged until the next update
+  value_type const& front() const noexcept {
+    return _buffer[_front];
+  }
+
+private:
+  static constexpr std::uint8_t index {0x3};
+  static constexpr std::uint8_t fresh {0x4};
+
+  std::array<value_type, 3> _buffer {};
+  std::uint8_t _back {0};
+  std::atomic<std::uint8_t> _middle {1};
+  std::uint8_t _front {2};
+}; // class triple_buffer
+
+} // namespace OB
+
+#endif // OB_TRIPLE_BUFFER_HH